@@ -0,0 +1,213 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Streams 16-channel updates to protocol_chk while a protocol is running
+// and reports the acknowledged update rate and round trip latency once a
+// second.  Frame format is described in protocol_chk.cydsn/chan_cmd.h.
+//
+//   cc -O2 -o chan_stream chan_stream.c
+//   ./chan_stream /dev/ttyACM0 [updates per second]
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHAN_CMD_SET       0x01
+#define CHAN_CMD_ACK       0x81
+#define CHANNELS             16
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint16_t crc16(const uint8_t *data, int len)
+{
+    uint16_t crc = 0xffff;
+    int i;
+
+    while (len--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (i = 0; i < 8; i++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static int cobs_encode(const uint8_t *in, int len, uint8_t *out)
+{
+    int code_pos = 0, n = 1, i;
+    uint8_t code = 1;
+
+    for (i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = n++;
+            code = 1;
+        } else {
+            out[n++] = in[i];
+            code += 1;
+        }
+    }
+    out[code_pos] = code;
+    return n;
+}
+
+static int cobs_decode(uint8_t *buf, int len)
+{
+    int in = 0, out = 0, i;
+    uint8_t code;
+
+    while (in < len) {
+        code = buf[in++];
+        if (code == 0 || in + code - 1 > len) return 0;
+        for (i = 1; i < code; i++)
+            buf[out++] = buf[in++];
+        if (code < 0xff && in < len)
+            buf[out++] = 0;
+    }
+    return out;
+}
+
+static int open_port(const char *name)
+{
+    struct termios tio;
+    int fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) return -1;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+    return fd;
+}
+
+static void send_update(int fd, uint8_t seq, const int16_t value[])
+{
+    uint8_t payload[4 + 2 * CHANNELS + 2], frame[sizeof(payload) + 3];
+    int len = 0, n, i;
+    uint16_t crc;
+
+    payload[len++] = CHAN_CMD_SET;
+    payload[len++] = seq;
+    payload[len++] = 0;
+    payload[len++] = CHANNELS;
+    for (i = 0; i < CHANNELS; i++) {
+        payload[len++] = value[i];
+        payload[len++] = (uint16_t)value[i] >> 8;
+    }
+    crc = crc16(payload, len);
+    payload[len++] = crc >> 8;
+    payload[len++] = crc;
+
+    frame[0] = 0;
+    n = cobs_encode(payload, len, frame + 1) + 1;
+    frame[n++] = 0;
+    if (write(fd, frame, n) != n)
+        fprintf(stderr, "short write\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static uint64_t sent_at[256];
+    uint8_t rx[64], byte;
+    int rx_len = 0, rate, fd, len, i;
+    int16_t value[CHANNELS];
+    uint64_t next_send, next_report, now, rtt;
+    uint64_t rtt_total = 0, rtt_min = UINT64_MAX, rtt_max = 0, delay_total = 0;
+    unsigned applied = 0, replaced = 0, errors = 0, sent = 0;
+    uint8_t seq = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s tty [updates per second]\n", argv[0]);
+        return 1;
+    }
+    rate = argc > 2 ? atoi(argv[2]) : 200;
+    if (rate < 1) rate = 1;
+    if ((fd = open_port(argv[1])) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    next_send = next_report = now_us();
+    next_report += 1000000;
+    for (;;) {
+        now = now_us();
+        if (now >= next_send) {
+            // slow triangle on every channel, offset per channel
+            for (i = 0; i < CHANNELS; i++)
+                value[i] = (int16_t)((((sent * 50) + i * 2500) % 40000) - 20000);
+            for (i = 0; i < CHANNELS; i++)
+                value[i] = value[i] < 0 ? -value[i] - 10000 : 10000 - value[i];
+            sent_at[seq] = now;
+            send_update(fd, seq++, value);
+            sent += 1;
+            next_send += 1000000 / rate;
+        }
+
+        while (read(fd, &byte, 1) == 1) {
+            // 0x00 only ends a frame, text and overlong runs fail to decode
+            if (byte == 0) {
+                if (rx_len && rx_len <= (int)sizeof(rx)) {
+                    len = cobs_decode(rx, rx_len);
+                    if (len == 7 && rx[0] == CHAN_CMD_ACK
+                        && crc16(rx, 5) == ((uint16_t)rx[5] << 8 | rx[6])) {
+                        if (rx[2] == 0) {
+                            rtt = now_us() - sent_at[rx[1]];
+                            rtt_total += rtt;
+                            if (rtt < rtt_min) rtt_min = rtt;
+                            if (rtt > rtt_max) rtt_max = rtt;
+                            delay_total += rx[3] | rx[4] << 8;
+                            applied += 1;
+                        } else if (rx[2] == 1) {
+                            replaced += 1;
+                        } else {
+                            errors += 1;
+                        }
+                    }
+                }
+                rx_len = 0;
+            } else if (rx_len < (int)sizeof(rx)) {
+                rx[rx_len++] = byte;
+            } else {
+                rx_len = sizeof(rx) + 1;
+            }
+        }
+
+        if (now >= next_report) {
+            printf("sent %u applied %u/s replaced %u errors %u", sent, applied, replaced, errors);
+            if (applied)
+                printf("  rtt min %llu avg %llu max %llu us, on-board wait avg %llu us",
+                       (unsigned long long)rtt_min, (unsigned long long)(rtt_total / applied),
+                       (unsigned long long)rtt_max, (unsigned long long)(delay_total / applied));
+            printf("\n");
+            fflush(stdout);
+            applied = replaced = errors = sent = 0;
+            rtt_total = delay_total = rtt_max = 0;
+            rtt_min = UINT64_MAX;
+            next_report += 1000000;
+        }
+        usleep(100);
+    }
+}
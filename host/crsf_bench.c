@@ -0,0 +1,149 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs receiver_chk's CRSF parser over a random stream of back to back
+// channel, link statistics and telemetry frames with some bytes corrupted,
+// checks that every intact channel frame comes out with its channels and
+// reports the parser's cost per byte.
+//
+//   cc -O2 -DEMULATOR -I../receiver_chk.cydsn -o crsf_bench crsf_bench.c ../receiver_chk.cydsn/crsf.c
+//   ./crsf_bench [passes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crsf.h"
+
+#define STREAM    (1 << 20)         // bytes
+#define CORRUPT   1000              // one byte in this many
+
+static uint8 stream[STREAM];
+static uint32 stream_len;
+
+// what was sent, in stream order, for the channel frames
+static uint16 sent[STREAM / 26][CRSF_CHANNELS];
+static uint8 intact[STREAM / 26];
+static uint32 num_sent;
+
+static void put_frame(uint8 type, const uint8 payload[], uint8 len)
+{
+    uint8 *f = &stream[stream_len];
+
+    f[0] = CRSF_ADDR_FC;
+    f[1] = len + 2;
+    f[2] = type;
+    memcpy(&f[3], payload, len);
+    f[3 + len] = crsf_crc8(&f[2], len + 1);
+    stream_len += len + 4;
+}
+
+static void put_channels(void)
+{
+    uint8 payload[22];
+    uint32 acc = 0;
+    uint8 bits = 0, *p = payload, ch;
+
+    for (ch = 0; ch < CRSF_CHANNELS; ch++) {
+        sent[num_sent][ch] = 172 + rand() % 1640;
+        acc |= (uint32)sent[num_sent][ch] << bits;
+        bits += 11;
+        while (bits >= 8) {
+            *p++ = acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    put_frame(CRSF_TYPE_CHANNELS, payload, sizeof payload);
+    intact[num_sent++] = 1;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    long runs = argc > 1 ? atol(argv[1]) : 50;
+    uint8 payload[32], i;
+    uint32 n, start_len, got = 0, wrong = 0, lost = 0, corrupted = 0, frame = 0;
+    uint16 channels[CRSF_CHANNELS];
+    crsf_parser parser;
+    double start, elapsed;
+    long run;
+
+    srand(1);
+    while (stream_len < STREAM - 64) {
+        start_len = stream_len;
+        switch (rand() % 8) {
+        case 0:
+            for (i = 0; i < 10; i++)
+                payload[i] = rand();
+            put_frame(CRSF_TYPE_LINK, payload, 10);
+            break;
+        case 1:
+            for (i = 0; i < 8; i++)
+                payload[i] = rand();
+            put_frame(CRSF_TYPE_BATTERY, payload, 8);
+            break;
+        default:
+            put_channels();
+            break;
+        }
+        for (n = start_len; n < stream_len; n++) {
+            if (rand() % CORRUPT == 0) {
+                stream[n] ^= 1 << (rand() % 8);
+                corrupted += 1;
+                if (stream[start_len + 2] == CRSF_TYPE_CHANNELS || n == start_len + 2)
+                    intact[num_sent - 1] = 0;
+            }
+        }
+    }
+
+    // intact frames must all come out in order with their channels, even
+    // right behind a frame whose length byte was damaged
+    memset(&parser, 0, sizeof parser);
+    for (n = 0; n < stream_len; n++) {
+        if (!crsf_byte(&parser, stream[n]) || crsf_type(&parser) != CRSF_TYPE_CHANNELS)
+            continue;
+        crsf_channels(crsf_payload(&parser), channels);
+        while (frame < num_sent && memcmp(channels, sent[frame], sizeof channels)) {
+            lost += intact[frame];
+            frame += 1;
+        }
+        if (frame == num_sent)
+            wrong += 1;
+        else
+            frame += 1;
+        got += 1;
+    }
+    printf("%u channel frames, %u bytes corrupted, %u decoded, %u intact lost, %u wrong, %u bad crc, %u bad length\n",
+           num_sent, corrupted, got, lost, wrong, parser.bad_crc, parser.bad_len);
+
+    start = now_s();
+    for (run = 0; run < runs; run++) {
+        crsf_reset(&parser);
+        for (n = 0; n < stream_len; n++)
+            if (crsf_byte(&parser, stream[n]) && crsf_type(&parser) == CRSF_TYPE_CHANNELS)
+                crsf_channels(crsf_payload(&parser), channels);
+    }
+    elapsed = now_s() - start;
+    printf("%.1f ns per byte, %.0f Mbyte/s\n", elapsed * 1e9 / runs / stream_len,
+           runs * stream_len / elapsed / 1e6);
+    return wrong != 0 || lost != 0;
+}
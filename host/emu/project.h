@@ -0,0 +1,26 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _EMU_PROJECT_H_
+#define _EMU_PROJECT_H_
+
+// Stands in for the project.h PSoC Creator generates, so the protocol_chk
+// protocol sources build on a host with -DEMULATOR.  The types come from
+// proto_engine.h; the component calls the protocols make are provided by
+// the host tool, see proto_engine_sim.c.
+#include "proto_engine.h"
+
+void CyDelayUs(uint32 us);
+void USB_serial_UartPutString(const char string[]);
+
+#endif
@@ -0,0 +1,190 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Checks protocol_chk's mixer against a reference that divides: the
+// identity mix, curve knots, reverse, subtrim and endpoints must match it
+// exactly over the whole input range, weighted mixes to within the
+// rounding of their terms, using the weights as stored.  Then reports
+// mixes per second.
+//
+//   cc -O2 -DEMULATOR -I../protocol_chk.cydsn -o mixer_bench mixer_bench.c ../protocol_chk.cydsn/mixer.c
+//   ./mixer_bench [mixes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mixer.h"
+
+#define RANGE   10000
+
+static volatile int32 in[MIXER_INPUTS];
+static int32 out[MIXER_OUTPUTS];
+static long errors;
+
+static int32 clamp(int32 v, int32 lo, int32 hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void expect(const char *what, int32 x, int32 got, int32 want, int32 tolerance)
+{
+    if (got - want > tolerance || want - got > tolerance) {
+        if (errors < 10)
+            printf("%s: input %d gave %d, reference %d\n", what, x, got, want);
+        errors += 1;
+    }
+}
+
+static void all_inputs(int32 x)
+{
+    uint8 i;
+
+    for (i = 0; i < MIXER_INPUTS; i++)
+        in[i] = x;
+}
+
+static void check_identity(void)
+{
+    int32 x;
+    uint8 i;
+
+    mixer_reset();
+    for (x = -RANGE; x <= RANGE; x++) {
+        all_inputs(x);
+        mixer_run(in, out);
+        for (i = 0; i < MIXER_OUTPUTS; i++)
+            expect("identity", x, out[i], x, 0);
+    }
+}
+
+// Knots of 5 and 9 point curves come out as the points, and between
+// them the output stays within the two points either side
+static void check_curve(uint8 num)
+{
+    static const int16 points5[5] = {-10000, -4000, 0, 5000, 10000};
+    static const int16 points9[9] = {-9000, -7000, -3000, -1000, 0, 2000, 4500, 8000, 9500};
+    const int16 *points = num == 5 ? points5 : points9;
+    int32 step = 2 * RANGE / (num - 1), x, k, lo, hi;
+
+    mixer_reset();
+    mixer_set_curve(0, points, num);
+    for (x = -RANGE; x <= RANGE; x++) {
+        in[0] = x;
+        mixer_run(in, out);
+        k = (x + RANGE) / step;
+        if ((x + RANGE) % step == 0) {
+            expect(num == 5 ? "5 point curve knot" : "9 point curve knot", x, out[0], points[k], 0);
+            continue;
+        }
+        lo = points[k] < points[k + 1] ? points[k] : points[k + 1];
+        hi = points[k] < points[k + 1] ? points[k + 1] : points[k];
+        expect(num == 5 ? "5 point curve" : "9 point curve", x, out[0], clamp(out[0], lo, hi), 0);
+    }
+}
+
+static void check_limits(void)
+{
+    int32 x;
+
+    mixer_reset();
+    mixer_set_limits(1, 0, -RANGE, RANGE, 1);
+    mixer_set_limits(2, 750, -RANGE, RANGE, 0);
+    mixer_set_limits(3, -1200, -RANGE, RANGE, 1);
+    mixer_set_limits(4, 0, -6000, 8000, 0);
+    mixer_set_limits(5, 300, -7000, 7000, 1);
+    for (x = -RANGE; x <= RANGE; x++) {
+        all_inputs(x);
+        mixer_run(in, out);
+        expect("reverse", x, out[1], -x, 0);
+        expect("subtrim", x, out[2], clamp(x + 750, -RANGE, RANGE), 0);
+        expect("reverse and subtrim", x, out[3], clamp(-x - 1200, -RANGE, RANGE), 0);
+        expect("endpoints", x, out[4], clamp(x, -6000, 8000), 0);
+        expect("all limits", x, out[5], clamp(-x + 300, -7000, 7000), 0);
+    }
+}
+
+// Random weighted mixes.  mixer_run against dividing by 1024 with the
+// stored weights, where each term may round by one; and how far percent
+// stored as 1/1024 steps moves the result, which is reported only.
+static void check_weights(void)
+{
+    int32 pct[MIXER_TERMS], want, exact, x, worst = 0;
+    uint8 src[MIXER_TERMS], t, n;
+    long trial;
+
+    srand(1);
+    for (trial = 0; trial < 20000; trial++) {
+        mixer_reset();
+        for (t = 0; t < MIXER_TERMS; t++) {
+            src[t] = rand() % MIXER_INPUTS;
+            pct[t] = rand() % 251 - 125;
+            mixer_set_term(0, t, src[t], pct[t]);
+        }
+        for (n = 0; n < MIXER_INPUTS; n++)
+            in[n] = rand() % (2 * RANGE + 1) - RANGE;
+        mixer_run(in, out);
+        want = exact = 0;
+        for (t = 0; t < MIXER_TERMS; t++) {
+            want += in[src[t]] * mixer[0].term[t].weight / 1024;
+            exact += in[src[t]] * pct[t] / 100;
+        }
+        x = in[src[0]];
+        expect("weighted mix", x, out[0], clamp(want, -RANGE, RANGE), MIXER_TERMS);
+        exact = clamp(exact, -RANGE, RANGE) - out[0];
+        if (exact < 0) exact = -exact;
+        if (exact > worst) worst = exact;
+    }
+    printf("percent weights in 1/1024 steps: up to %d off exact percent\n", worst);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    long runs = argc > 1 ? atol(argv[1]) : 5000000, i;
+    static const int16 curve[5] = {-10000, -4000, 0, 5000, 10000};
+    volatile int32 sink = 0;
+    double start, rate;
+    uint8 n;
+
+    check_identity();
+    check_curve(5);
+    check_curve(9);
+    check_limits();
+    check_weights();
+    printf("%ld mismatches against the reference\n", errors);
+
+    // the bench preset in main.c: expo on three sticks, throttle curve
+    mixer_reset();
+    mixer_set_expo(0, 40);
+    mixer_set_expo(1, 40);
+    mixer_set_expo(3, 30);
+    mixer_set_curve(2, curve, 5);
+    start = now_s();
+    for (i = 0; i < runs; i++) {
+        for (n = 0; n < 4; n++)
+            in[n] = (int32)((i * (n + 3) * 37) % (2 * RANGE + 1)) - RANGE;
+        mixer_run(in, out);
+        sink += out[i & 3];
+    }
+    rate = runs / (now_s() - start);
+    printf("%.0f mixes/s, %.1f ns per mix of %d outputs\n", rate, 1e9 / rate, MIXER_OUTPUTS);
+    return errors != 0;
+}
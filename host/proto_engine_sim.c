@@ -0,0 +1,322 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs protocol_chk's protocol engine with SymaX, YD717 and CX10 in every
+// format against a simulated nRF24L01 that records each payload with its
+// time, RF channel and phase, then prints the packet timing of each phase.
+// Every run is made twice, building in the tick and building ahead in a
+// simulated main loop, and the two packet streams must match.  The YD717
+// receiver starts unbound so the bind phases run, and the CX-10A aircraft
+// answers bind packets so BIND2 can complete.
+//
+//   cc -O2 -DEMULATOR -Iemu -I../protocol_chk.cydsn -o proto_engine_sim proto_engine_sim.c ../protocol_chk.cydsn/proto_engine.c ../protocol_chk.cydsn/symax_proto.c ../protocol_chk.cydsn/yd717_proto.c ../protocol_chk.cydsn/cx10_nrf24l01.c
+//   ./proto_engine_sim [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <project.h>
+#include "nrf24l01.h"
+#include "protocols.h"
+#include "settings.h"
+
+#define MAX_LOG         16384
+#define REPLY_AFTER        10       // CX-10A bind packets before the aircraft answers
+#define REPLY_US          500       // from the bind packet to the answer
+
+typedef struct {
+    uint32 time;                    // us from start
+    uint8  phase;
+    uint8  rf_ch;
+    uint8  len;
+    uint8  xn297;
+    uint8  data[PROTO_MAX_PACKET];
+} sent_packet;
+
+static sent_packet sent[2][MAX_LOG];
+static uint32 num_sent[2];
+static sent_packet *log_to;
+static uint32 *log_len;
+
+// simulated radio
+static uint32 sim_now;              // us, the tick time plus delays in the tick
+static proto_instance *sim_inst;
+static uint8 reg_config, reg_status, reg_rf_ch;
+static uint8 tx_addr[5];
+static uint8 rx_full, rx_bound;
+static uint32 bind_heard, reply_at, replies_lost, delay_us;
+
+settings_data settings;
+static uint32 settings_saves;
+
+// The aircraft's answer lands if the radio is still receiving when it comes
+static void radio_update(void)
+{
+    if (!reply_at || (int32)(sim_now - reply_at) < 0)
+        return;
+    if (reg_config & BV(NRF24L01_00_PRIM_RX)) {
+        reg_status |= BV(NRF24L01_07_RX_DR);
+        rx_full = 1;
+    } else {
+        replies_lost += 1;
+    }
+    reply_at = 0;
+}
+
+// An auto-ack receiver starts unbound.  It binds on a packet to an
+// address of five equal bytes, the YD717 bind addresses, and from then on
+// acks everything; until then nothing is acked.
+static void auto_ack(void)
+{
+    if (!memcmp(tx_addr, &tx_addr[1], sizeof tx_addr - 1))
+        rx_bound = 1;
+    reg_status |= rx_bound ? BV(NRF24L01_07_TX_DS) : BV(NRF24L01_07_MAX_RT);
+}
+
+static void record(const uint8 *data, uint8 len, uint8 xn297)
+{
+    sent_packet *s;
+
+    radio_update();
+    auto_ack();
+    if (*log_len == MAX_LOG)
+        return;
+    s = &log_to[(*log_len)++];
+    s->time = sim_now;
+    s->phase = sim_inst->phase;
+    s->rf_ch = reg_rf_ch;
+    s->len = len > PROTO_MAX_PACKET ? PROTO_MAX_PACKET : len;
+    s->xn297 = xn297;
+    memcpy(s->data, data, s->len);
+}
+
+void NRF24L01_Initialize() {}
+int  NRF24L01_Reset() { return 1; }
+uint8 NRF24L01_Activate(uint8 code) { (void)code; return 0; }
+uint8 NRF24L01_FlushTx() { return 0; }
+uint8 NRF24L01_SetBitrate(uint8 bitrate) { (void)bitrate; return 0; }
+uint8 NRF24L01_SetPower(uint8 power) { (void)power; return 0; }
+void XN297_SetTXAddr(const uint8 *addr, int len) { (void)addr; (void)len; }
+void XN297_SetRXAddr(const uint8 *addr, int len) { (void)addr; (void)len; }
+
+uint8 NRF24L01_FlushRx()
+{
+    radio_update();
+    rx_full = 0;
+    return 0;
+}
+
+uint8 NRF24L01_WriteReg(uint8 reg, uint8 data)
+{
+    radio_update();
+    switch (reg) {
+    case NRF24L01_00_CONFIG: reg_config = data; break;
+    case NRF24L01_05_RF_CH:  reg_rf_ch = data; break;
+    case NRF24L01_07_STATUS: reg_status &= ~(data & 0x70); break;
+    }
+    return 0;
+}
+
+uint8 NRF24L01_WriteRegisterMulti(uint8 reg, const uint8 data[], uint8 length)
+{
+    if (reg == NRF24L01_10_TX_ADDR && length == sizeof tx_addr)
+        memcpy(tx_addr, data, sizeof tx_addr);
+    return 0;
+}
+
+uint8 NRF24L01_ReadReg(uint8 reg)
+{
+    radio_update();
+    switch (reg) {
+    case NRF24L01_00_CONFIG: return reg_config;
+    case NRF24L01_05_RF_CH:  return reg_rf_ch;
+    case NRF24L01_07_STATUS: return reg_status;
+    }
+    return 0;
+}
+
+void NRF24L01_SetTxRxMode(enum TxRxState mode)
+{
+    radio_update();
+    if (mode == RX_EN)
+        reg_config |= BV(NRF24L01_00_PRIM_RX);
+    else
+        reg_config &= ~BV(NRF24L01_00_PRIM_RX);
+}
+
+uint8 NRF24L01_WritePayload(uint8 *data, uint8 len)
+{
+    record(data, len, 0);
+    return 0;
+}
+
+void XN297_Configure(uint8 flags)
+{
+    radio_update();
+    reg_config = flags;
+}
+
+uint8 XN297_WritePayload(uint8 *msg, int len)
+{
+    record(msg, len, 1);
+    // CX-10A bind packets, sent from a listen phase, get the aircraft id
+    if (sim_inst->desc->phases[sim_inst->phase].listen && ++bind_heard == REPLY_AFTER)
+        reply_at = sim_now + REPLY_US;
+    return 0;
+}
+
+uint8 XN297_ReadPayload(uint8 *msg, int len)
+{
+    static const uint8 aircraft_id[4] = {0x12, 0x34, 0x56, 0x78};
+
+    radio_update();
+    memset(msg, 0, len);
+    if (rx_full && len >= 9)
+        memcpy(&msg[5], aircraft_id, sizeof aircraft_id);
+    rx_full = 0;
+    return 0;
+}
+
+void CyDelayUs(uint32 us)
+{
+    sim_now += us;
+    delay_us += us;
+}
+
+void USB_serial_UartPutString(const char string[]) { (void)string; }
+
+void settings_save(void)
+{
+    settings_saves += 1;
+}
+
+// Sticks moving slowly enough to see in the packets
+static void set_channels(volatile int32 channels[], uint32 t)
+{
+    uint8 i;
+
+    for (i = 0; i < PROTO_NUM_CHANNELS; i++)
+        channels[i] = (int32)((t / 1000 * (i + 1) * 37) % 20001) - 10000;
+}
+
+static void run(const proto_desc *desc, uint8 format, uint8 deferred, uint32 duration)
+{
+    static proto_instance inst;
+    static uint8 own_addr[5] = {0xa5, 0x5a, 0x3c, 0xc3, 0x01};
+    volatile int32 channels[PROTO_NUM_CHANNELS];
+    uint32 tick = 0;
+
+    log_to = sent[deferred];
+    log_len = &num_sent[deferred];
+    *log_len = 0;
+    sim_inst = &inst;
+    sim_now = 0;
+    reg_config = reg_status = reg_rf_ch = rx_full = rx_bound = 0;
+    memset(tx_addr, 0, sizeof tx_addr);
+    bind_heard = reply_at = replies_lost = delay_us = 0;
+    memset(&settings, 0, sizeof settings);
+    settings_saves = 0;
+
+    proto_engine_start(&inst, desc, format, own_addr);
+    inst.deferred = deferred;
+    while ((int32)(tick - duration) < 0) {
+        // main loop between ticks, then the timer interrupt
+        set_channels(channels, tick);
+        if (deferred)
+            proto_engine_prepare(&inst, channels);
+        if (desc->background)
+            desc->background(&inst);
+        sim_now = tick;
+        tick += proto_engine_run(&inst, channels);
+    }
+}
+
+static void report_phases(void)
+{
+    const sent_packet *s = sent[0], *end = s + num_sent[0], *first;
+    uint32 min, max, gap;
+    uint8 chans[16], num_chans, i;
+
+    while (s < end) {
+        first = s;
+        min = 0xffffffff;
+        max = 0;
+        num_chans = 0;
+        for (; s < end && s->phase == first->phase; s++) {
+            if (s > first) {
+                gap = s->time - s[-1].time;
+                if (gap < min) min = gap;
+                if (gap > max) max = gap;
+            }
+            for (i = 0; i < num_chans && chans[i] != s->rf_ch; i++)
+                ;
+            if (i == num_chans && num_chans < sizeof chans)
+                chans[num_chans++] = s->rf_ch;
+        }
+        printf("  phase %u from %8.3fms: %5u packets", first->phase, first->time / 1000.0,
+               (unsigned)(s - first));
+        if (s - first > 1)
+            printf(" every %u..%uus", min, max);
+        printf(", len %u%s, ch", first->len, first->xn297 ? " xn297" : "");
+        for (i = 0; i < num_chans; i++)
+            printf(" %02x", chans[i]);
+        printf("\n   ");
+        for (i = 0; i < first->len; i++)
+            printf(" %02x", first->data[i]);
+        printf("\n");
+    }
+}
+
+// Building ahead must not change a single packet or its time
+static uint32 compare_streams(void)
+{
+    uint32 i, n = num_sent[0] < num_sent[1] ? num_sent[0] : num_sent[1];
+
+    for (i = 0; i < n; i++) {
+        if (sent[0][i].time != sent[1][i].time || sent[0][i].rf_ch != sent[1][i].rf_ch
+            || sent[0][i].len != sent[1][i].len
+            || memcmp(sent[0][i].data, sent[1][i].data, sent[0][i].len))
+            break;
+    }
+    if (i == n && num_sent[0] == num_sent[1])
+        return 0;
+    printf("  deferred builds differ from packet %u at %uus\n", i, i < n ? sent[0][i].time : 0);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    static const proto_desc * const descs[] = {&symax_desc, &yd717_desc, &cx10_desc};
+    uint32 duration = (argc > 1 ? atol(argv[1]) : 8) * 1000000, failed = 0;
+    uint8 d, f, formats;
+
+    for (d = 0; d < sizeof descs / sizeof descs[0]; d++) {
+        formats = descs[d]->formats ? descs[d]->num_formats : 1;
+        for (f = 0; f < formats; f++) {
+            run(descs[d], f, 0, duration);
+            printf("%s: %u packets in %us, %uus in delays\n",
+                   proto_engine_format_name(sim_inst), num_sent[0], duration / 1000000, delay_us);
+            report_phases();
+            if (descs[d] == &cx10_desc && f == FORMAT_CX10_BLUE) {
+                printf("  aircraft id %s, %u saves, %u replies lost\n",
+                       settings.cx10_bound ? "saved" : "not saved", settings_saves, replies_lost);
+                failed |= !settings.cx10_bound;
+            }
+            failed |= num_sent[0] == 0;
+            run(descs[d], f, 1, duration);
+            failed |= compare_streams();
+        }
+    }
+    return failed != 0;
+}
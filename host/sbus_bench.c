@@ -0,0 +1,135 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Checks receiver_chk's sbus_decode() against the original bit-by-bit
+// loop on random frames, checks that sbus_encode() gives each frame back
+// from its decode, and reports frames per second.
+//
+//   cc -O2 -DEMULATOR -I../receiver_chk.cydsn -o sbus_bench sbus_bench.c ../receiver_chk.cydsn/sbus.c
+//   ./sbus_bench [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sbus.h"
+
+#define FRAMES     4096             // distinct random frames
+#define MAX_CHANS    18
+
+// The decoder receiver_chk used before sbus.c
+static void sbus_decode_bits(const uint8 frame[], volatile int32 channels[])
+{
+    uint8 byte_in_sbus = 1;
+    uint8 bit_in_sbus = 0;
+    uint8 ch = 0;
+    uint8 bit_in_channel = 0;
+
+    memset((void *)channels, 0, 16 * sizeof channels[0]);
+
+    // channel data is interleaved and bit-reversed
+    for (int i=0; i < 176; i++) {
+        if (frame[byte_in_sbus] & (1<<bit_in_sbus)) {
+            channels[ch] |= (1<<bit_in_channel);
+        }
+        bit_in_sbus = (bit_in_sbus + 1) % 8;
+        if (bit_in_sbus == 0) byte_in_sbus++;
+        bit_in_channel = (bit_in_channel + 1) % 11;
+        if (bit_in_channel == 0) ch++;
+    }
+    channels[16] = (frame[23] & 1) ? 2000 : 1000;
+    channels[17] = (frame[23] & 2) ? 2000 : 1000;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint8 frames[FRAMES][SBUS_FRAME_LEN];
+static volatile int32 channels[MAX_CHANS];
+static sbus_frame decoded;
+static uint8 encoded[SBUS_FRAME_LEN];
+static volatile uint32 sink;        // keeps the timed loops from being optimised away
+
+int main(int argc, char *argv[])
+{
+    long runs = argc > 1 ? atol(argv[1]) : 10000000;
+    double start, bits_rate, word_rate, encode_rate;
+    long i, mismatches = 0, round_trips = 0;
+    int f, ch;
+
+    srand(1);
+    for (f = 0; f < FRAMES; f++) {
+        frames[f][0] = 0x0f;
+        for (i = 1; i < SBUS_FRAME_LEN - 1; i++)
+            frames[f][i] = rand();
+        frames[f][SBUS_FRAME_LEN - 1] = 0x00;
+    }
+
+    for (f = 0; f < FRAMES; f++) {
+        sbus_decode_bits(frames[f], channels);
+        sbus_decode(frames[f], &decoded);
+        for (ch = 0; ch < MAX_CHANS; ch++) {
+            if (channels[ch] != decoded.channels[ch]) {
+                if (!mismatches)
+                    printf("frame %d channel %d: bit loop %d, word %u\n",
+                           f, ch + 1, (int)channels[ch], decoded.channels[ch]);
+                mismatches += 1;
+            }
+        }
+    }
+    printf("%d random frames, %ld channel mismatches\n", FRAMES, mismatches);
+
+    for (f = 0; f < FRAMES; f++) {
+        sbus_decode(frames[f], &decoded);
+        sbus_encode(&decoded, encoded);
+        if (memcmp(encoded, frames[f], SBUS_FRAME_LEN)) {
+            if (!round_trips)
+                printf("frame %d does not survive decode and encode\n", f);
+            round_trips += 1;
+        }
+    }
+    printf("%d random frames, %ld round trip failures\n", FRAMES, round_trips);
+
+    start = now_s();
+    for (i = 0; i < runs; i++) {
+        sbus_decode_bits(frames[i & (FRAMES - 1)], channels);
+        sink += channels[i & 15];
+    }
+    bits_rate = runs / (now_s() - start);
+
+    start = now_s();
+    for (i = 0; i < runs; i++) {
+        sbus_decode(frames[i & (FRAMES - 1)], &decoded);
+        sink += decoded.channels[i & 15];
+    }
+    word_rate = runs / (now_s() - start);
+
+    start = now_s();
+    for (i = 0; i < runs; i++) {
+        decoded.channels[i & 15] = i & 0x7ff;
+        sbus_encode(&decoded, encoded);
+        sink += encoded[1 + (i & 15)];
+    }
+    encode_rate = runs / (now_s() - start);
+
+    printf("bit loop   %12.0f frames/s\n", bits_rate);
+    printf("word       %12.0f frames/s  (%.1fx)\n", word_rate, word_rate / bits_rate);
+    printf("encode     %12.0f frames/s\n", encode_rate);
+    return mismatches != 0 || round_trips != 0;
+}
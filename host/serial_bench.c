@@ -0,0 +1,213 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Checks receiver_chk's serial receiver decoders on random frames: each
+// protocol must give its channels back and no other protocol may accept
+// the frame or any prefix of it, as serial_rx would offer them.  Then
+// reports decoded frames per second for each protocol.
+//
+//   cc -O2 -DEMULATOR -I../receiver_chk.cydsn -o serial_bench serial_bench.c ../receiver_chk.cydsn/serial_proto.c ../receiver_chk.cydsn/sbus.c
+//   ./serial_bench [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "serial_proto.h"
+
+#define FRAMES     1024             // distinct random frames per protocol
+
+typedef struct {
+    uint8 len;
+    uint8 buf[SERIAL_MAX_FRAME];
+    uint8 num;                      // channels carried
+    uint8 ids[SERIAL_CHANNELS];
+    uint16 us[SERIAL_CHANNELS];
+    uint8 tolerance;                // us lost to the protocol's resolution
+} test_frame;
+
+static uint16 random_us(void)
+{
+    return 1000 + rand() % 1001;
+}
+
+static void build_sbus(test_frame *t)
+{
+    sbus_frame f;
+    uint8 i;
+
+    memset(&f, 0, sizeof f);
+    t->num = SBUS_CHANNELS;
+    for (i = 0; i < SBUS_CHANNELS; i++) {
+        t->ids[i] = i;
+        t->us[i] = random_us();
+        f.channels[i] = (t->us[i] - 880) * 8 / 5;
+    }
+    f.channels[16] = f.channels[17] = 1000;
+    sbus_encode(&f, t->buf);
+    t->len = SBUS_FRAME_LEN;
+    t->tolerance = 1;
+}
+
+static void build_ibus(test_frame *t)
+{
+    uint16 sum = 0xffff;
+    uint8 i;
+
+    t->buf[0] = 0x20;
+    t->buf[1] = 0x40;
+    t->num = 14;
+    for (i = 0; i < 14; i++) {
+        t->ids[i] = i;
+        t->us[i] = random_us();
+        t->buf[2 + 2*i] = t->us[i];
+        t->buf[3 + 2*i] = t->us[i] >> 8;
+    }
+    for (i = 0; i < 30; i++)
+        sum -= t->buf[i];
+    t->buf[30] = sum;
+    t->buf[31] = sum >> 8;
+    t->len = 32;
+    t->tolerance = 0;
+}
+
+static void build_sumd(test_frame *t)
+{
+    uint8 n = 8 + rand() % 9, i;
+    uint16 crc, v;
+
+    t->buf[0] = 0xa8;
+    t->buf[1] = 0x01;
+    t->buf[2] = n;
+    t->num = n;
+    for (i = 0; i < n; i++) {
+        t->ids[i] = i;
+        t->us[i] = random_us();
+        v = t->us[i] * 8;
+        t->buf[3 + 2*i] = v >> 8;
+        t->buf[4 + 2*i] = v;
+    }
+    crc = serial_crc16(t->buf, 3 + 2*n);
+    t->buf[3 + 2*n] = crc >> 8;
+    t->buf[4 + 2*n] = crc;
+    t->len = 5 + 2*n;
+    t->tolerance = 0;
+}
+
+// DSMX 11ms 2048: seven of the twelve channels per frame
+static void build_dsm(test_frame *t)
+{
+    uint8 first = rand() % 6, i;
+    uint16 v;
+
+    t->buf[0] = rand() % 4;
+    t->buf[1] = 0xb2;
+    t->num = 7;
+    for (i = 0; i < 7; i++) {
+        t->ids[i] = first + i;
+        t->us[i] = random_us();
+        v = (uint16)(first + i) << 11 | (uint16)((t->us[i] - 988) * 2);
+        t->buf[2 + 2*i] = v >> 8;
+        t->buf[3 + 2*i] = v;
+    }
+    t->len = 16;
+    t->tolerance = 0;
+}
+
+static void (* const builders[])(test_frame *) = {
+    build_sbus, build_ibus, build_sumd, build_dsm,
+};
+
+// Offers the frame to another protocol the way serial_rx does: each
+// prefix while the length fits, the whole frame as if a gap followed
+static uint8 accepted_by(uint8 proto, const test_frame *t)
+{
+    const serial_proto *p = &serial_protos[proto];
+    serial_frame out;
+    uint8 len, want;
+
+    memset(&out, 0, sizeof out);
+    for (len = 1; len <= t->len; len++) {
+        want = p->length(t->buf, len);
+        if (!want || len > want)
+            return 0;
+        if (len == want && (len == t->len || !p->gap_only) && p->decode(t->buf, len, &out))
+            return 1;
+    }
+    return 0;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static test_frame frames[FRAMES];
+static serial_frame decoded;
+static volatile uint32 sink;
+
+int main(int argc, char *argv[])
+{
+    long runs = argc > 1 ? atol(argv[1]) : 2000000;
+    long i, errors = 0, false_matches = 0;
+    uint8 p, q, ch;
+    int f, diff;
+    double start, rate;
+
+    srand(1);
+    for (p = 0; p < serial_num_protos; p++) {
+        for (f = 0; f < FRAMES; f++) {
+            builders[p](&frames[f]);
+            memset(&decoded, 0, sizeof decoded);
+            if (!serial_protos[p].decode(frames[f].buf, frames[f].len, &decoded)) {
+                errors += 1;
+                continue;
+            }
+            for (ch = 0; ch < frames[f].num; ch++) {
+                diff = decoded.channels[frames[f].ids[ch]] - frames[f].us[ch];
+                if (diff > frames[f].tolerance || diff < -frames[f].tolerance) {
+                    if (!errors)
+                        printf("%s frame %d channel %d: sent %uus, got %uus\n", serial_protos[p].name,
+                               f, frames[f].ids[ch] + 1, frames[f].us[ch],
+                               decoded.channels[frames[f].ids[ch]]);
+                    errors += 1;
+                }
+            }
+            for (q = 0; q < serial_num_protos; q++) {
+                if (q != p && accepted_by(q, &frames[f])) {
+                    if (!false_matches)
+                        printf("%s frame %d accepted as %s\n", serial_protos[p].name, f,
+                               serial_protos[q].name);
+                    false_matches += 1;
+                }
+            }
+        }
+
+        start = now_s();
+        for (i = 0; i < runs; i++) {
+            test_frame *t = &frames[i & (FRAMES - 1)];
+            sink += serial_protos[p].decode(t->buf, t->len, &decoded);
+            sink += decoded.channels[i & 7];
+        }
+        rate = runs / (now_s() - start);
+        printf("%-5s %12.0f frames/s  %6.1f ns/byte\n", serial_protos[p].name, rate,
+               1e9 / rate / frames[0].len);
+    }
+    printf("%d frames per protocol, %ld decode errors, %ld false matches\n",
+           FRAMES, errors, false_matches);
+    return errors != 0 || false_matches != 0;
+}
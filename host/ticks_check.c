@@ -0,0 +1,91 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// Checks ticks.h's multiply and shift against exact division for every
+// 16-bit tick count, at the capture clocks receiver_chk (3MHz) and
+// protocol_chk (12MHz) use, at the 24 and 48MHz system clocks timebase.c
+// converts SysTick cycles from, and at the other whole MHz clocks up to 48MHz,
+// checks that TICKS_EXACT(), which stops TICKS_TO_US() compiling for an
+// inexact clock, agrees at every one, and checks ticks_since() across the
+// counter wrap.
+//
+//   cc -O2 -DEMULATOR -I../receiver_chk.cydsn -o ticks_check ticks_check.c
+//   ./ticks_check
+
+#include <stdio.h>
+#include "ticks.h"
+
+#define CHECK(hz) check(#hz, hz, TICKS_MUL(hz), TICKS_SHIFT(hz), TICKS_EXACT(hz))
+
+static int check(const char *name, unsigned long hz, unsigned long mul, unsigned shift,
+                 int exact)
+{
+    unsigned long div = TICKS_PER_US(hz);
+    unsigned long ticks, bad = 0, first = 0;
+
+    for (ticks = 0; ticks <= 0xffff; ticks++) {
+        if (((uint32)ticks * mul >> shift) != ticks / div && !bad++)
+            first = ticks;
+    }
+    if (bad)
+        printf("%-9s /%-2lu mul %6lu shift %u: %lu wrong, first at %lu\n", name, div, mul,
+               shift, bad, first);
+    else
+        printf("%-9s /%-2lu mul %6lu shift %u: exact\n", name, div, mul, shift);
+    if (exact != !bad) {
+        printf("%-9s TICKS_EXACT says %d\n", name, exact);
+        return 1;
+    }
+    return bad != 0;
+}
+
+static int check_wrap(void)
+{
+    unsigned long now, then, bad = 0;
+
+    for (then = 0; then <= 0xffff; then += 257) {
+        for (now = 0; now <= 0xffff; now++) {
+            if (ticks_since(now, then) != (now + 0x10000 - then) % 0x10000)
+                bad += 1;
+        }
+    }
+    printf("ticks_since across the wrap: %lu wrong\n", bad);
+    return bad != 0;
+}
+
+int main(void)
+{
+    int failed = 0;
+    unsigned long mhz;
+
+    failed |= CHECK(3000000);
+    failed |= CHECK(12000000);
+    failed |= CHECK(24000000);
+    failed |= CHECK(48000000);
+    failed |= check_wrap();
+
+    // other clocks only need TICKS_EXACT to agree, not to be exact
+    for (mhz = 1; mhz <= 48; mhz++) {
+        if (mhz != 3 && mhz != 12 && mhz != 24 && mhz != 48) {
+            unsigned long hz = mhz * 1000000;
+            char name[16];
+
+            snprintf(name, sizeof name, "%luMHz", mhz);
+            if (check(name, hz, TICKS_MUL(hz), TICKS_SHIFT(hz), TICKS_EXACT(hz)) &&
+                TICKS_EXACT(hz))
+                failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,239 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "chan_cmd.h"
+#include "protocols.h"
+#include "timebase.h"
+#include "wavegen.h"
+
+#define MAX_FRAME  (4 + 2 * CHAN_CMD_CHANNELS + 2 + 2)   // payload plus COBS overhead
+#define KEY_GAP     2000              // us of quiet before a byte can be a keystroke
+#define FRAME_GAP  20000              // us of quiet that abandons a frame
+
+#define RX_IDLE       0               // between frames, keystrokes allowed
+#define RX_FRAME      1
+#define RX_DISCARD    2               // bad frame, skip to the next 0x00
+
+typedef struct {
+    uint8  seq;
+    uint8  first;
+    uint8  count;
+    uint32 stamp;                     // timebase_us() when queued
+    int32  value[CHAN_CMD_CHANNELS];
+} chan_update;
+
+static uint8 rx_buf[MAX_FRAME];
+static uint8 rx_len;
+static uint8 rx_state;
+static uint32 last_rx;
+
+// Main loop fills update[fill] then hands it over through pending, so the
+// interrupt never sees a half written update.
+static chan_update update[2];
+static uint8 fill;
+static volatile uint8 pending;        // index + 1 of the update to apply, 0 if none
+static volatile uint8 applied;        // an applied update is not yet acked
+static volatile uint8 applied_seq;
+static volatile uint32 applied_delay;
+
+
+static uint16 crc16(const uint8 *data, uint8 len)
+{
+    uint16 crc = 0xffff;
+    uint8 i;
+
+    while (len--) {
+        crc ^= (uint16)*data++ << 8;
+        for (i = 0; i < 8; i++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// Decodes in place, returns decoded length or 0 on a malformed frame
+static uint8 cobs_decode(uint8 *buf, uint8 len)
+{
+    uint8 in = 0, out = 0, code, i;
+
+    while (in < len) {
+        code = buf[in++];
+        if (code == 0 || in + code - 1 > len) return 0;
+        for (i = 1; i < code; i++)
+            buf[out++] = buf[in++];
+        if (code < 0xff && in < len)
+            buf[out++] = 0;
+    }
+    return out;
+}
+
+static void send_frame(uint8 *payload, uint8 len)
+{
+    uint8 code_pos = 0, code = 1, i;
+    uint8 out[16];
+    uint8 n = 1;
+    uint16 crc = crc16(payload, len);
+
+    payload[len++] = crc >> 8;
+    payload[len++] = crc;
+
+    for (i = 0; i < len; i++) {
+        if (payload[i] == 0) {
+            out[code_pos] = code;
+            code_pos = n++;
+            code = 1;
+        } else {
+            out[n++] = payload[i];
+            code += 1;
+        }
+    }
+    out[code_pos] = code;
+
+    USB_serial_UartPutChar(0);
+    for (i = 0; i < n; i++)
+        USB_serial_UartPutChar(out[i]);
+    USB_serial_UartPutChar(0);
+}
+
+static void send_ack(uint8 seq, uint8 status, uint16 delay)
+{
+    uint8 payload[7] = {CHAN_CMD_ACK, seq, status, delay, delay >> 8};
+
+    send_frame(payload, 5);
+}
+
+static uint16 get16(const uint8 *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static void frame_done(void)
+{
+    chan_update *u = &update[fill];
+    uint8 len = cobs_decode(rx_buf, rx_len);
+    uint8 i, replaced, intr;
+    int32 value;
+
+    if (len < 4) return;
+    if (crc16(rx_buf, len - 2) != ((uint16)rx_buf[len - 2] << 8 | rx_buf[len - 1])) {
+        send_ack(rx_buf[1], CHAN_CMD_BAD_CRC, 0);
+        return;
+    }
+    if (rx_buf[0] == CHAN_CMD_WAVE && len == 12) {
+        if (rx_buf[2] >= WAVEGEN_CHANNELS || rx_buf[3] >= WAVE_SHAPES) {
+            send_ack(rx_buf[1], CHAN_CMD_BAD_FRAME, 0);
+            return;
+        }
+        wavegen_set(rx_buf[2], rx_buf[3], get16(&rx_buf[4]), get16(&rx_buf[6]), get16(&rx_buf[8]));
+        send_ack(rx_buf[1], CHAN_CMD_APPLIED, 0);
+        return;
+    }
+    if (rx_buf[0] != CHAN_CMD_SET || len != 6 + 2 * rx_buf[3]
+        || rx_buf[2] + rx_buf[3] > CHAN_CMD_CHANNELS) {
+        send_ack(rx_buf[1], CHAN_CMD_BAD_FRAME, 0);
+        return;
+    }
+
+    u->seq = rx_buf[1];
+    u->first = rx_buf[2];
+    u->count = rx_buf[3];
+    for (i = 0; i < u->count; i++) {
+        value = (int16)get16(&rx_buf[4 + 2 * i]);
+        if (value > CHAN_MAX_VALUE) value = CHAN_MAX_VALUE;
+        if (value < CHAN_MIN_VALUE) value = CHAN_MIN_VALUE;
+        u->value[i] = value;
+    }
+    u->stamp = timebase_us();
+
+    // an update still waiting is superseded by this one
+    intr = CyEnterCriticalSection();
+    replaced = pending;
+    pending = fill + 1;
+    CyExitCriticalSection(intr);
+    if (replaced)
+        send_ack(update[replaced - 1].seq, CHAN_CMD_REPLACED, 0);
+    fill ^= 1;
+}
+
+// Feed every byte received while a protocol runs.  Returns 0 if the byte
+// is a keystroke for the caller: one of keys, between frames and after
+// KEY_GAP of quiet, which bytes inside a frame never have.  0x00 only ends
+// a frame, so a lost delimiter costs the frames either side of it but
+// never turns frame bytes into keystrokes.  An overlong frame is skipped
+// up to the next 0x00.  Stray bytes that never see a 0x00, from a
+// terminal for example, are dropped after FRAME_GAP of quiet.
+uint8 chan_cmd_byte(uint8 c, const char *keys)
+{
+    uint32 now = timebase_us();
+    uint8 quiet = now - last_rx >= KEY_GAP;
+
+    if (rx_state != RX_IDLE && now - last_rx >= FRAME_GAP)
+        rx_state = RX_IDLE;
+    last_rx = now;
+
+    if (c == 0) {
+        if (rx_state == RX_FRAME)
+            frame_done();
+        rx_state = RX_IDLE;
+        return 1;
+    }
+    if (rx_state == RX_IDLE) {
+        if (quiet && strchr(keys, c))
+            return 0;
+        rx_state = RX_FRAME;
+        rx_len = 0;
+    }
+    if (rx_state == RX_DISCARD)
+        return 1;
+    if (rx_len >= sizeof(rx_buf)) {
+        rx_state = RX_DISCARD;
+        return 1;
+    }
+    rx_buf[rx_len++] = c;
+    return 1;
+}
+
+// Called from the protocol timer interrupt before the packet is built,
+// returns 1 when the channels changed
+uint8 chan_cmd_apply(volatile int32 channels[])
+{
+    chan_update *u;
+    uint8 i;
+
+    if (!pending) return 0;
+    u = &update[pending - 1];
+    for (i = 0; i < u->count; i++)
+        channels[u->first + i] = u->value[i];
+    applied_delay = timebase_us() - u->stamp;
+    applied_seq = u->seq;
+    applied = 1;
+    pending = 0;
+    return 1;
+}
+
+// Sends the acknowledgement for the last applied update
+void chan_cmd_poll(void)
+{
+    uint8 intr, seq;
+    uint32 delay;
+
+    if (!applied) return;
+    intr = CyEnterCriticalSection();
+    seq = applied_seq;
+    delay = applied_delay;
+    applied = 0;
+    CyExitCriticalSection(intr);
+
+    send_ack(seq, CHAN_CMD_APPLIED, delay > 0xffff ? 0xffff : delay);
+}
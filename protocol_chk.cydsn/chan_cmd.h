@@ -0,0 +1,51 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _CHAN_CMD_H_
+#define _CHAN_CMD_H_
+
+#include <project.h>
+
+// Binary channel commands on USB_serial while a protocol runs.  Frames are
+// COBS encoded and end with 0x00; a leading 0x00 as well is harmless and
+// resynchronises after line noise.  Keystrokes share the port and are
+// told apart by chan_cmd_byte().  Decoded payload:
+//
+//   type, seq, data..., crc16 (CCITT, init 0xffff, big endian)
+//
+//   CHAN_CMD_SET    first, count, count x int16 little endian
+//   CHAN_CMD_WAVE   channel, shape, amplitude, offset (int16 little endian),
+//                   frequency in 0.01Hz (uint16 little endian), see wavegen.h
+//   CHAN_CMD_ACK    status, apply delay in us (uint16 little endian)
+//
+// SET values go to the channels at the next packet boundary, all in the
+// same tick, and are acknowledged when applied.  chan_cmd_apply() returns 1
+// then, so a packet built ahead from the old values can be discarded.  WAVE takes effect and is
+// acknowledged at once.
+
+#define CHAN_CMD_SET       0x01
+#define CHAN_CMD_WAVE      0x02
+#define CHAN_CMD_ACK       0x81
+
+#define CHAN_CMD_APPLIED      0   // ack status
+#define CHAN_CMD_REPLACED     1   // newer frame arrived before the next packet
+#define CHAN_CMD_BAD_CRC      2
+#define CHAN_CMD_BAD_FRAME    3
+
+#define CHAN_CMD_CHANNELS    16
+
+uint8 chan_cmd_byte(uint8 c, const char *keys);
+uint8 chan_cmd_apply(volatile int32 channels[]);
+void  chan_cmd_poll(void);
+
+#endif
@@ -17,6 +17,7 @@
 #include "nrf24l01.h"
 #include "protocols.h"
 #include "protocol_chk.h"
+#include "settings.h"
 #include <stdio.h>
 
 
@@ -36,16 +37,13 @@
 #define FLAG_SNAPSHOT   0x0004
 
 
-enum {
-    PROTOOPTS_FORMAT = 0,
-    LAST_PROTO_OPT,
-};
+static uint8 protoopts_format = FORMAT_CX10_BLUE;
 
-enum {
-    FORMAT_CX10_GREEN = 0,
-    FORMAT_CX10_BLUE,
-    FORMAT_DM007,
-} protoopts_format = FORMAT_CX10_BLUE;
+static const char * const cx10_format_names[] = {
+    [FORMAT_CX10_GREEN] = "CX10 green",
+    [FORMAT_CX10_BLUE]  = "CX10 blue",
+    [FORMAT_DM007]      = "DM007",
+};
 
 // For code readability
 enum {
@@ -61,16 +59,14 @@ enum {
     CHANNEL10
 };
 
-static uint8 packet[CX10A_PACKET_SIZE]; // CX10A (blue board) has larger packet size
 static uint8 packet_size;
 static uint16 packet_period;
-static uint8 phase;
 static uint8 bind_phase;
-static uint16 bind_counter;
+static uint8 got_aircraft_id;
+static volatile uint8 save_pending;   // aircraft id waiting to go to flash
 //static uint8 tx_power;
 static uint16 throttle, rudder, elevator, aileron, flags, flags2;
 static const uint8 rx_tx_addr[] = {0xcc, 0xcc, 0xcc, 0xcc, 0xcc};
-static int32 Channels[8];   // simulate Deviation channels
 
 // frequency channel management
 #define RF_BIND_CHANNEL 0x02
@@ -83,6 +79,7 @@ enum {
     CX10_INIT1 = 0,
     CX10_BIND1,
     CX10_BIND2,
+    CX10_BIND3,
     CX10_DATA
 };
 
@@ -91,9 +88,9 @@ enum {
 
 // Channel values are servo time in ms, 1500ms is the middle,
 // 1000 and 2000 are min and max values
-static uint16 convert_channel(uint8 num)
+static uint16 convert_channel(proto_instance *p, uint8 num)
 {
-    int32 ch = Channels[num];
+    int32 ch = p->channels[num];
     if (ch < CHAN_MIN_VALUE) {
         ch = CHAN_MIN_VALUE;
     } else if (ch > CHAN_MAX_VALUE) {
@@ -102,29 +99,29 @@ static uint16 convert_channel(uint8 num)
     return (uint16) ((ch * 500 / CHAN_MAX_VALUE) + 1500);
 }
 
-static void read_controls(uint16* throttle, uint16* rudder, uint16* elevator, uint16* aileron, uint16* flags, uint16* flags2)
+static void read_controls(proto_instance *p, uint16* throttle, uint16* rudder, uint16* elevator, uint16* aileron, uint16* flags, uint16* flags2)
 {
     // Protocol is registered AETRF, that is
     // Aileron is channel 1, Elevator - 2, Throttle - 3, Rudder - 4
 
-    *aileron  = convert_channel(CHANNEL1);
+    *aileron  = convert_channel(p, CHANNEL1);
     // Correct direction so the model file would be straightforward
-    *elevator = 3000 - convert_channel(CHANNEL2);
-    *throttle = convert_channel(CHANNEL3);
+    *elevator = 3000 - convert_channel(p, CHANNEL2);
+    *throttle = convert_channel(p, CHANNEL3);
     // Same for rudder
-    *rudder   = 3000 - convert_channel(CHANNEL4);
+    *rudder   = 3000 - convert_channel(p, CHANNEL4);
 
     *flags &= ~FLAG_MODE_MASK;
     // Channel 5 - mode
-    if (Channels[CHANNEL5] > 0) {
-        if (Channels[CHANNEL5] < CHAN_MAX_VALUE / 2)
+    if (p->channels[CHANNEL5] > 0) {
+        if (p->channels[CHANNEL5] < CHAN_MAX_VALUE / 2)
             *flags |= 1;
         else
             *flags |= 2; // headless on CX-10A
     }
 
     // Channel 6 - flip flag
-    if (Channels[CHANNEL6] <= 0)
+    if (p->channels[CHANNEL6] <= 0)
         *flags &= ~FLAG_FLIP;
     else
         *flags |= FLAG_FLIP;
@@ -134,19 +131,19 @@ static void read_controls(uint16* throttle, uint16* rudder, uint16* elevator, ui
         *aileron = 3000 - *aileron;
         
         // Channel 7 - snapshot
-        if(Channels[CHANNEL7] <= 0)
+        if(p->channels[CHANNEL7] <= 0)
             *flags2 &= ~FLAG_SNAPSHOT;
         else
             *flags2 |= FLAG_SNAPSHOT;
 
         // Channel 8 - video
-        if(Channels[CHANNEL8] <=0)
+        if(p->channels[CHANNEL8] <=0)
             *flags2 &= ~FLAG_VIDEO;
         else
             *flags2 |= FLAG_VIDEO;
 
-        // Channel 9 - headless
-        if (Channels[CHANNEL9] <= 0)
+        // Channel 9 - headless, only if the engine snapshots that many
+        if (CHANNEL9 >= PROTO_NUM_CHANNELS || p->channels[CHANNEL9] <= 0)
             *flags &= ~FLAG_HEADLESS;
         else
             *flags |= FLAG_HEADLESS;
@@ -154,8 +151,9 @@ static void read_controls(uint16* throttle, uint16* rudder, uint16* elevator, ui
 
 }
 
-static void send_packet(uint8 bind)
+static uint8 build_packet(proto_instance *p, uint8 bind)
 {
+    uint8 *packet = p->packet;
     uint8 offset=0;
     if(protoopts_format == FORMAT_CX10_BLUE)
         offset = 4;
@@ -165,7 +163,7 @@ static void send_packet(uint8 bind)
     packet[3] = txid[2];
     packet[4] = txid[3];
     // for CX-10A [5]-[8] is aircraft id received during bind 
-    read_controls(&throttle, &rudder, &elevator, &aileron, &flags, &flags2);
+    read_controls(p, &throttle, &rudder, &elevator, &aileron, &flags, &flags2);
     packet[5+offset] = aileron & 0xff;
     packet[6+offset] = (aileron >> 8) & 0xff;
     packet[7+offset] = elevator & 0xff;
@@ -176,11 +174,25 @@ static void send_packet(uint8 bind)
     packet[12+offset] = ((rudder >> 8) & 0xff) | ((flags & FLAG_FLIP) >> 8);  // 0x10 here is a flip flag 
     packet[13+offset] = flags & 0xff;
     packet[14+offset] = flags2 & 0xff;
+    return packet_size;
+}
+
+static uint8 cx10_build_bind(proto_instance *p)
+{
+    return build_packet(p, 1);
+}
+
+static uint8 cx10_build_data(proto_instance *p)
+{
+    return build_packet(p, 0);
+}
 
+static void cx10_send(proto_instance *p, uint8 len)
+{
     // Power on, TX mode, 2byte CRC
     // Why CRC0? xn297 does not interpret it - either 16-bit CRC or nothing
     XN297_Configure(BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_CRCO) | BV(NRF24L01_00_PWR_UP));
-    if (bind) {
+    if (p->phase != CX10_DATA) {
         NRF24L01_WriteReg(NRF24L01_05_RF_CH, RF_BIND_CHANNEL);
     } else {
         NRF24L01_WriteReg(NRF24L01_05_RF_CH, rf_chans[current_chan++]);
@@ -190,8 +202,17 @@ static void send_packet(uint8 bind)
     NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
     NRF24L01_FlushTx();
 
-    XN297_WritePayload(packet, packet_size);
+    XN297_WritePayload(p->packet, len);
 
+    if (p->phase == CX10_BIND2) {
+        // listen for the aircraft id reply until the next bind packet
+        CyDelayUs(15);  // usleep(15);
+        NRF24L01_FlushRx();
+        NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70); // Clear data ready, data sent, and retransmit
+        // switch to RX mode
+        XN297_Configure(BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_CRCO) 
+                      | BV(NRF24L01_00_PWR_UP) | BV(NRF24L01_00_PRIM_RX)); 
+    }
 }
 
 void cx10_initialize()
@@ -272,51 +293,66 @@ void cx10_initialize()
 }
 
 
-uint16 cx10_callback(volatile int32 channels[])
+static uint8 cx10_next_init1(proto_instance *p)
 {
-    memcpy(Channels, (const void *)channels, sizeof(Channels));
-    
-    switch (phase) {
-    case CX10_INIT1:
-        phase = bind_phase;
-        break;
-
-    case CX10_BIND1:
-        if (bind_counter == 0) {
-            phase = CX10_DATA;
-        } else {
-            send_packet(1);
-            bind_counter -= 1;
-        }
-        break;
-        
-    case CX10_BIND2:
-//        printd("00_config = 0x%02x\r\n", NRF24L01_ReadReg(NRF24L01_00_CONFIG));
-        if( NRF24L01_ReadReg(NRF24L01_07_STATUS) & BV(NRF24L01_07_RX_DR)) { // RX fifo data ready
-            XN297_ReadPayload(packet, packet_size);
-            USB_serial_UartPutString("RX Packet\r\n");
-            NRF24L01_SetTxRxMode(TXRX_OFF);
-            NRF24L01_SetTxRxMode(TX_EN);
-            bind_counter = 10;
-            phase = CX10_BIND1; 
-        } else {
-            NRF24L01_SetTxRxMode(TXRX_OFF);
-            NRF24L01_SetTxRxMode(TX_EN);
-            send_packet(1);
-            CyDelayUs(15);  // usleep(15);
-            NRF24L01_FlushRx();
-            NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70); // Clear data ready, data sent, and retransmit
-            // switch to RX mode
-            XN297_Configure(BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_CRCO) 
-                          | BV(NRF24L01_00_PWR_UP) | BV(NRF24L01_00_PRIM_RX)); 
-        }
-        break;
-
-    case CX10_DATA:
-        send_packet(0);
-        break;
+    (void)p;
+    return bind_phase;
+}
+
+// CX-10A: send bind packets until the aircraft answers with its id
+static uint8 cx10_build_bind2(proto_instance *p)
+{
+//    printd("00_config = 0x%02x\r\n", NRF24L01_ReadReg(NRF24L01_00_CONFIG));
+    if( NRF24L01_ReadReg(NRF24L01_07_STATUS) & BV(NRF24L01_07_RX_DR)) { // RX fifo data ready
+        XN297_ReadPayload(p->packet, packet_size);
+        memcpy(settings.cx10_txid, txid, sizeof(txid));
+        memcpy(settings.cx10_aircraft_id, &p->packet[5], sizeof(settings.cx10_aircraft_id));
+        settings.cx10_format = protoopts_format;
+        settings.cx10_bound = 1;
+        save_pending = 1;
+        NRF24L01_SetTxRxMode(TXRX_OFF);
+        NRF24L01_SetTxRxMode(TX_EN);
+        got_aircraft_id = 1;
+        return 0;
     }
-    return packet_period;
+    NRF24L01_SetTxRxMode(TXRX_OFF);
+    NRF24L01_SetTxRxMode(TX_EN);
+    return build_packet(p, 1);
+}
+
+static uint8 cx10_next_bind2(proto_instance *p)
+{
+    (void)p;
+    return got_aircraft_id ? CX10_BIND3 : PROTO_STAY;
+}
+
+static const proto_phase cx10_phases[] = {
+    [CX10_INIT1] = { .repeat = 1, .next = cx10_next_init1 },
+    [CX10_BIND1] = { .build = cx10_build_bind,
+                     .repeat = BIND_COUNT, .next_phase = CX10_DATA },
+    [CX10_BIND2] = { .build = cx10_build_bind2, .radio_build = 1, .listen = 1,
+                     .next = cx10_next_bind2 },
+    [CX10_BIND3] = { .build = cx10_build_bind,
+                     .repeat = 10, .next_phase = CX10_DATA },
+    [CX10_DATA]  = { .build = cx10_build_data,
+                     .next_phase = PROTO_STAY },
+};
+
+// Flash write for a new aircraft id, done outside the timer interrupt
+static void cx10_background(proto_instance *p)
+{
+    (void)p;
+    if (save_pending) {
+        save_pending = 0;
+        settings_save();
+        USB_serial_UartPutString("RX Packet, aircraft id saved\r\n");
+    }
+}
+
+void cx10_forget_bind(void)
+{
+    settings.cx10_bound = 0;
+    settings_save();
 }
 
 // Generate address to use from TX id and manufacturer id (STM32 unique id)
@@ -330,22 +366,27 @@ static void initialize_txid()
     txid[1] = ((lfsr >> 16) & 0xFF) % 0x30;
     txid[2] = (lfsr >> 8) & 0xFF;
     txid[3] = lfsr & 0xFF;
-    // rf channels
+}
+
+static void initialize_rf_chans()
+{
     rf_chans[0] = 0x03 + (txid[0] & 0x0F);
     rf_chans[1] = 0x16 + (txid[0] >> 4);
     rf_chans[2] = 0x2D + (txid[1] & 0x0F);
     rf_chans[3] = 0x40 + (txid[1] >> 4);
 }
 
-void cx10_init(uint8 *unused)
+static void cx10_init(proto_instance *p, uint8 *unused)
 {
+    (void)unused;
+    protoopts_format = p->format;
+    initialize_txid();
     switch( protoopts_format) {
         case FORMAT_CX10_GREEN:
         case FORMAT_DM007:
             packet_size = CX10_PACKET_SIZE;
             packet_period = CX10_PACKET_PERIOD;
             bind_phase = CX10_BIND1;
-            bind_counter = BIND_COUNT;
             break;
         
         case FORMAT_CX10_BLUE:
@@ -354,17 +395,58 @@ void cx10_init(uint8 *unused)
             bind_phase = CX10_BIND2;
             uint8 i;
             for(i=0; i<4; i++)
-                packet[5+i] = 0xFF; // clear aircraft id
-            packet[9] = 0;
+                p->packet[5+i] = 0xFF; // clear aircraft id
+            p->packet[9] = 0;
+            // reconnect to a known aircraft without the bind handshake
+            if (settings.cx10_bound && settings.cx10_format == FORMAT_CX10_BLUE) {
+                memcpy(txid, settings.cx10_txid, sizeof(txid));
+                memcpy(&p->packet[5], settings.cx10_aircraft_id, sizeof(settings.cx10_aircraft_id));
+                bind_phase = CX10_DATA;
+            }
             break;
     }
-    initialize_txid();
+    initialize_rf_chans();
+    current_chan = 0;
+    save_pending = 0;
     flags = 0;
     flags2 = 0;
+    got_aircraft_id = 0;
     cx10_initialize();
-    phase = CX10_INIT1;
+    p->period = packet_period;
 }
 
+// Radio setup that differs from other protocols, restored when sharing the
+// radio.  Send configures the XN297 emulation and channel every packet.
+// RX mode for the CX-10A reply is not restored: a reply that arrived while
+// another protocol had the radio is gone, which is why BIND2 listens and
+// proto_sched keeps the radio for it.
+static void cx10_resume(proto_instance *p)
+{
+    (void)p;
+    NRF24L01_WriteReg(NRF24L01_01_EN_AA, 0x00);      // No Auto Acknowldgement on all data pipes
+    NRF24L01_WriteReg(NRF24L01_02_EN_RXADDR, 0x01);  // Enable data pipe 0 only
+    NRF24L01_WriteReg(NRF24L01_11_RX_PW_P0, packet_size);
+    NRF24L01_WriteReg(NRF24L01_1C_DYNPD, 0x00);
+    NRF24L01_WriteReg(NRF24L01_1D_FEATURE, 0x00);
+    NRF24L01_SetBitrate(NRF24L01_BR_1M);             // 1Mbps
+    NRF24L01_WriteReg(NRF24L01_06_RF_SETUP, 0x07);
+    XN297_SetTXAddr(rx_tx_addr, 5);
+    XN297_SetRXAddr(rx_tx_addr, 5);
+}
+
+const proto_desc cx10_desc = {
+    .name = "CX10",
+    .init = cx10_init,
+    .send = cx10_send,
+    .background = cx10_background,
+    .resume = cx10_resume,
+    .phases = cx10_phases,
+    .num_phases = sizeof(cx10_phases) / sizeof(cx10_phases[0]),
+    .period = CX10A_PACKET_PERIOD,
+    .formats = cx10_format_names,
+    .num_formats = sizeof(cx10_format_names) / sizeof(cx10_format_names[0]),
+};
+
 
 
 
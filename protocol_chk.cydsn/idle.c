@@ -0,0 +1,63 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "idle.h"
+
+static volatile uint8 idle_events;
+
+
+static void idle_rx_event(void)
+{
+    idle_signal(EVENT_RX);
+}
+
+static void idle_tick_event(void)
+{
+    idle_signal(EVENT_TICK);
+}
+
+// Hooks the USB serial interrupt, call after USB_serial_Start()
+void idle_start(void)
+{
+    USB_serial_SetCustomInterruptHandler(idle_rx_event);
+}
+
+// SysTick wake for loops polling a FIFO that has no interrupt.  Only for
+// projects that do not use SysTick as a timebase.
+void idle_tick_start(uint32 us)
+{
+    CySysTickStart();
+    CySysTickSetReload(us * CYDEV_BCLK__SYSCLK__MHZ - 1);
+    CySysTickClear();
+    CySysTickSetCallback(0, idle_tick_event);
+}
+
+void idle_signal(uint8 events)
+{
+    uint8 intr = CyEnterCriticalSection();
+    idle_events |= events;
+    CyExitCriticalSection(intr);
+}
+
+// WFI wakes on a pending interrupt even with interrupts masked, so an
+// event between the check and the sleep cannot be lost.  The interrupt
+// itself runs when the critical section ends.
+void idle_wait(void)
+{
+    uint8 intr = CyEnterCriticalSection();
+    if (!idle_events)
+        CY_PM_WFI;
+    idle_events = 0;
+    CyExitCriticalSection(intr);
+}
@@ -16,7 +16,19 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "nrf24l01.h"
+#include "chan_cmd.h"
+#include "ppm_input.h"
 #include "protocols.h"
+#include "idle.h"
+#include "mixer.h"
+#include "proto_clock.h"
+#include "proto_sched.h"
+#include "proto_stats.h"
+#include "settings.h"
+#include "task_queue.h"
+#include "ticks.h"
+#include "timebase.h"
+#include "wavegen.h"
 
 
 void printd(char *str, uint32 data) {
@@ -60,32 +72,64 @@ void DUT_getchan(uint8 channels[]) {
 }
 
 
+// bottom half tasks run from the proto_run loop, highest priority first
+#define TASK_BUILD   0    // build the next protocol packet
+#define TASK_REPORT  1    // monitor printing
+
 #define MAX_CHANS 16
 static volatile int32 Channels[MAX_CHANS] = {0, 0, CHAN_MIN_VALUE, 0, 1000, 1000, 1000, 1000};
 static volatile uint8 number_of_channels;
 
+static uint8 ppm_bridge;    // PPM input drives the protocol instead of the keyboard
+static uint16 bridge_callback(volatile int32 channels[]);
+
 static uint16 (*proto_callback)(volatile int32[]) = NULL;
 CY_ISR(proto_timer_interrupt_service) {
-  if (proto_callback) proto_timer_WritePeriod( proto_callback(Channels) );
+  uint8 phase = proto_callback == proto_engine_callback || proto_callback == bridge_callback
+              ? proto_active.phase : 0;
+  uint16 period;
+
+  proto_stats_enter();
+  // a packet built ahead in the main loop would miss these changes
+  if (chan_cmd_apply(Channels) | wavegen_apply(Channels))
+    proto_engine_discard(&proto_active);
+  period = proto_clock_tick(proto_callback, Channels);
+  proto_timer_WritePeriod(period - 1);    // counts 0 to period inclusive
+  proto_stats_exit(phase, period);
+  if (proto_active.deferred && proto_callback == proto_engine_callback)
+    task_post(TASK_BUILD);
+  idle_signal(EVENT_TIMER);
   proto_timer_ClearInterrupt(proto_timer_INTR_MASK_TC);
 }
 
+#define PPM_TIMER_HZ 12000000       // ppm_timer's C/T clock
+
 static uint32 max_width;
+static volatile uint16 max_capture_latency;   // ppm_timer counts from edge to ISR entry
+
+static void capture_latency(uint32 capture) {
+  uint16 latency = (uint16)(ppm_timer_ReadCounter() - capture);
+  if (latency > max_capture_latency) max_capture_latency = latency;
+}
+
 CY_ISR(ppm_timer_interrupt_service) {
   static uint16 prev_capture;
   static uint32 curr_channel;
   uint32 curr_capture = ppm_timer_ReadCapture();
-  uint32 width = ((curr_capture - prev_capture) % 0xffff) / 12;   // microseconds - divisor from C/T clock
+  capture_latency(curr_capture);
+  uint32 width = TICKS_TO_US(ticks_since(curr_capture, prev_capture), PPM_TIMER_HZ);
   prev_capture = curr_capture;
+  idle_signal(EVENT_CAPTURE);
+  ppm_input_pulse(width);
   
   if (width > max_width) max_width = width;
   if (width > 3000) {
     number_of_channels = curr_channel;
     curr_channel = 0;
   } else {
-//    Channels[curr_channel++] = ((int)width - 1500) * 20;
-    Channels[curr_channel++] = (int)width;
-    curr_channel %= MAX_CHANS;
+    if (!ppm_bridge)
+      Channels[curr_channel] = (int)width;
+    curr_channel = (curr_channel + 1) % MAX_CHANS;
   }
   
   ppm_timer_ClearInterrupt(ppm_timer_INTR_MASK_CC_MATCH);
@@ -95,7 +139,8 @@ CY_ISR(pwm_timer_interrupt_service) {
   static uint32 int_mode = ppm_timer_TRIG_RISING;  // start mode as set in main
   static uint32 prev_capture;
   uint32 curr_capture = ppm_timer_ReadCapture();
-  uint32 width = ((curr_capture - prev_capture) % 0xffff) / 12;   // microseconds - divisor from C/T clock
+  capture_latency(curr_capture);
+  uint32 width = TICKS_TO_US(ticks_since(curr_capture, prev_capture), PPM_TIMER_HZ);
   prev_capture = curr_capture;
   
   if (int_mode == ppm_timer_TRIG_RISING) {
@@ -107,6 +152,7 @@ CY_ISR(pwm_timer_interrupt_service) {
     number_of_channels = 1;
     Channels[0] = width;
   }
+  idle_signal(EVENT_CAPTURE);
 
   ppm_timer_ClearInterrupt(ppm_timer_INTR_MASK_CC_MATCH);
 }
@@ -125,9 +171,114 @@ void channel_step(uint8 channel, int32 step) {
   if (Channels[channel] < CHAN_MIN_VALUE) Channels[channel] = CHAN_MIN_VALUE;
 }
 
+// Restart the running engine protocol on its next format variant
+static void proto_next_format(uint8 tx_addr[]) {
+  const proto_desc *desc = proto_active.desc;
+
+  if ((proto_callback != proto_engine_callback && proto_callback != bridge_callback)
+      || !desc || desc->num_formats < 2)
+    return;
+
+  proto_timer_int_Disable();
+  proto_engine_select(desc, (proto_active.format + 1) % desc->num_formats);
+  proto_engine_init(tx_addr);
+  if (proto_callback == bridge_callback)
+    proto_active.deferred = 0;
+  proto_timer_int_ClearPending();
+  proto_timer_int_Enable();
+  USB_serial_UartPutString(proto_engine_format_name(&proto_active));
+  USB_serial_UartPutString("\r\n");
+}
+
+// PPM frame to air latency, from the frame's last pulse to the payload
+// write of the first packet built from it
+static volatile struct {
+  uint32 count;
+  uint32 total;
+  uint32 min;
+  uint32 max;
+} bridge_latency;
+static uint32 bridge_seq;
+static uint32 bridge_stamp;
+static uint8 bridge_waiting;
+
+static void bridge_init(uint8 tx_addr[]) {
+  ppm_input_reset();
+  proto_engine_init(tx_addr);
+  proto_active.deferred = 0;    // build from the newest frame in the interrupt
+  bridge_seq = 0;
+  bridge_waiting = 0;
+  bridge_latency.count = 0;
+}
+
+static uint16 bridge_callback(volatile int32 channels[]) {
+  const ppm_frame *f = ppm_input_latest();
+  uint32 packets = proto_active.packets;
+  uint32 latency;
+  uint16 period;
+  uint8 i;
+
+  if (f && f->seq != bridge_seq) {
+    for (i = 0; i < f->num && i < PROTO_NUM_CHANNELS; i++)
+      channels[i] = ppm_to_proto(f->width[i]);
+    bridge_seq = f->seq;
+    bridge_stamp = f->stamp;
+    bridge_waiting = 1;
+  }
+
+  period = proto_engine_callback(channels);
+
+  if (bridge_waiting && proto_active.packets != packets) {
+    bridge_waiting = 0;
+    latency = timebase_us() - bridge_stamp;
+    if (bridge_latency.count == 0) {
+      bridge_latency.total = 0;
+      bridge_latency.min = latency;
+      bridge_latency.max = latency;
+    }
+    if (latency < bridge_latency.min) bridge_latency.min = latency;
+    if (latency > bridge_latency.max) bridge_latency.max = latency;
+    bridge_latency.count += 1;
+    bridge_latency.total += latency;
+  }
+  return period;
+}
+
+static void bridge_report(void) {
+  uint32 count, total, min, max;
+
+  proto_timer_int_Disable();
+  count = bridge_latency.count;
+  total = bridge_latency.total;
+  min = bridge_latency.min;
+  max = bridge_latency.max;
+  proto_timer_int_Enable();
+
+  printd("ppm to air frames %lu", count);
+  if (!count) {
+    USB_serial_UartPutString("\r\n");
+    return;
+  }
+  printd(" min %luus", min);
+  printd(" max %luus", max);
+  printd(" mean %luus\r\n", total / count);
+}
+
+static void ppm_capture_start(void) {
+  ppm_timer_Stop();
+  ppm_timer_SetCaptureMode(ppm_timer_TRIG_FALLING);
+  ppm_timer_int_StartEx(ppm_timer_interrupt_service);
+  number_of_channels = 0;
+  ppm_timer_Start();
+}
+
+// Keys proto_run() handles, everything else on the port is channel commands
+static const char run_keys[] = " ftzbq";
+
 void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32 channels[])) {
   uint8 def_addr[] = {0x3b,0xb6,0x00,0x00,0xa2};
   uint8 ch, loop=1;
+  wavegen_edge edge;
   
   if (init)
     init(def_addr);
@@ -136,11 +287,27 @@ void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32
   proto_timer_int_Disable();  // just in case
   proto_timer_int_ClearPending();
   proto_callback = callback;
+  proto_clock_reset();
+  proto_stats_reset();
   proto_timer_int_Enable();
   
   while(loop) {
+    while (task_run())
+      ;
+    if (callback == proto_sched_callback)
+      proto_sched_background();
+    else
+      proto_engine_background();
+    chan_cmd_poll();
+    while (wavegen_next_edge(&edge)) {
+      printd("edge ch%lu", edge.channel + 1);
+      printd(edge.level ? " high at %luus\r\n" : " low at %luus\r\n", edge.stamp);
+    }
     if (USB_serial_SpiUartGetRxBufferSize()) {
-      switch (ch=USB_serial_UartGetChar()) {
+      ch = USB_serial_UartGetChar();
+      if (chan_cmd_byte(ch, run_keys))
+        continue;
+      switch (ch) {
 #if 0
       case '1':
       case '2':
@@ -163,15 +330,75 @@ void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32
         Channels[ELEVATOR] = 0;
         Channels[AILERON] = 0;
         break;
+
+      case 'f':
+        proto_next_format(def_addr);
+        break;
+
+      case 't':
+        proto_stats_report();
+        printd("deadline misses %lu", proto_clock_misses);
+        printd(" long wait splits %lu\r\n", proto_clock_splits);
+        printd("capture latency max %luus", TICKS_TO_US(max_capture_latency, PPM_TIMER_HZ));
+        printd(" late builds %lu\r\n", proto_active.late_builds);
+        if (callback == bridge_callback)
+          bridge_report();
+        break;
+
+      case 'z':
+        proto_stats_reset();
+        max_capture_latency = 0;
+        bridge_latency.count = 0;
+        break;
+
+      case 'b':
+        proto_engine_defer ^= 1;
+        proto_active.deferred = proto_engine_defer && callback == proto_engine_callback;
+        USB_serial_UartPutString(proto_engine_defer ? "packets built in main loop\r\n"
+                                                    : "packets built in interrupt\r\n");
+        break;
         
       case 'q':
         proto_timer_int_Disable();
         loop = 0;
       }
+    } else {
+      idle_wait();
     }
   }
 }
 
+// Bench mix: expo on the sticks and a soft throttle curve
+static void mixer_preset(void) {
+  static const int16 throttle_curve[5] = {-10000, -4000, 0, 5000, 10000};
+
+  mixer_reset();
+  mixer_set_expo(AILERON, 40);
+  mixer_set_expo(ELEVATOR, 40);
+  mixer_set_expo(RUDDER, 30);
+  mixer_set_curve(THROTTLE, throttle_curve, 5);
+}
+
+// Stick test pattern: sine aileron, triangle elevator, rudder steps on
+// the marker pin.  Throttle stays where it is.
+static void wavegen_preset(void) {
+  wavegen_reset();
+  wavegen_set(AILERON, WAVE_SINE, 10000, 0, 50);          // 0.5Hz
+  wavegen_set(ELEVATOR, WAVE_TRIANGLE, 10000, 0, 20);     // 0.2Hz
+  wavegen_set(RUDDER, WAVE_SQUARE, 5000, 0, 100);         // 1Hz
+}
+
+// Runs the selected engine protocol from the keyboard or the PPM input
+static void proto_run_engine(void) {
+  if (ppm_bridge) {
+    ppm_capture_start();
+    proto_run(bridge_init, bridge_callback);
+    ppm_timer_int_Stop();
+  } else {
+    proto_run(proto_engine_init, proto_engine_callback);
+  }
+}
+
 void symax_capture() {
   uint8 tx_addr[5], channels[4];
 //  uint32 number = 0x0000b63b;
@@ -188,16 +415,17 @@ void symax_capture() {
     DUT_reset();
     
     memcpy(tx_addr, &number, sizeof(uint32));
-    symax_init(tx_addr);
+    proto_engine_start(&proto_active, &symax_desc, 0, tx_addr);
 
     // run the protocol callback with timer interrupt
     proto_timer_int_ClearPending();
-    proto_callback = symax_callback;
+    proto_callback = proto_engine_callback;
+    proto_clock_reset();
     proto_timer_int_Enable();
     
     // wait for data phase
     loopcount = 0;
-    while (symax_phase != 3) {
+    while (proto_active.phase != SYMAX_DATA) {
       if (loopcount++ > 5000) break;
       CyDelay(10);
     }
@@ -214,6 +442,65 @@ void symax_capture() {
   }
 }
 
+// Bind the DUT on each of the 32 low address values and compare the
+// hop channels it reports against the symax table.  Only mismatches
+// and timeouts are printed.
+void symax_verify() {
+  uint8 tx_addr[5], channels[4];
+  uint32 number = 0x00001940;
+  const uint8 *expected;
+  char outbuf[64];
+  uint32 loopcount;
+  uint8 i, errors = 0;
+
+  tx_addr[4] = 0xa2;
+
+  for (i = 0; i < 32; i++, number++) {
+    proto_timer_int_Disable();
+
+    if (USB_serial_SpiUartGetRxBufferSize() && USB_serial_UartGetChar() == 'q')
+      return;
+
+    DUT_reset();
+
+    memcpy(tx_addr, &number, sizeof(uint32));
+    proto_engine_start(&proto_active, &symax_desc, 0, tx_addr);
+
+    // run the protocol callback with timer interrupt
+    proto_timer_int_ClearPending();
+    proto_callback = proto_engine_callback;
+    proto_clock_reset();
+    proto_timer_int_Enable();
+
+    // wait for data phase
+    loopcount = 0;
+    while (proto_active.phase != SYMAX_DATA) {
+      if (loopcount++ > 500) break;
+      CyDelay(10);
+    }
+    if (loopcount > 500) {
+      snprintf(outbuf, sizeof(outbuf), "lb:%02X bind timeout\r\n", tx_addr[0]);
+      USB_serial_UartPutString(outbuf);
+      errors += 1;
+      continue;
+    }
+
+    DUT_getchan(channels);
+
+    expected = symax_hop_channels(tx_addr[0]);
+    if (memcmp(channels, expected, sizeof(channels))) {
+      snprintf(outbuf, sizeof(outbuf),
+               "lb:%02X table %02X%02X%02X%02X dut %02X%02X%02X%02X\r\n", tx_addr[0],
+               expected[0], expected[1], expected[2], expected[3],
+               channels[0], channels[1], channels[2], channels[3]);
+      USB_serial_UartPutString(outbuf);
+      errors += 1;
+    }
+  }
+  proto_timer_int_Disable();
+  printd("symax_verify done, %lu errors\r\n", errors);
+}
+
 void symax_bind32() {
   uint8 tx_addr[5];
   uint32 number = 0xffffffe0;
@@ -230,17 +517,18 @@ void symax_bind32() {
     DUT_reset();
     
     memcpy(tx_addr, &number, sizeof(uint32));
-    symax_init(tx_addr);
+    proto_engine_start(&proto_active, &symax_desc, 0, tx_addr);
 
     // run the protocol callback with timer interrupt
     proto_timer_int_ClearPending();
-    proto_callback = symax_callback;
+    proto_callback = proto_engine_callback;
+    proto_clock_reset();
     proto_timer_int_Enable();
 
     loop = 1;
     while(loop) {
           // wait for data phase
-      if (symax_phase == 3) {
+      if (proto_active.phase == SYMAX_DATA) {
         snprintf(outbuf, sizeof(outbuf),
              "%02X%02X%02X%02X%02X bound\r\n", tx_addr[4], tx_addr[3],
              tx_addr[2], tx_addr[1], tx_addr[0]);
@@ -290,9 +578,8 @@ void read_xn297() {
 
 }
 
-uint16 ppm_monitor(volatile int32 channels[])
+static void ppm_report(void)
 {
-  CyDelay(300);
   static char outbuf[127];
   char *pc = outbuf;
   int8 nc;
@@ -301,31 +588,87 @@ uint16 ppm_monitor(volatile int32 channels[])
 
   nc = number_of_channels;
   for (int i=0; i < nc; i++) {
-    chars_out = snprintf(pc, size, "%6ld ", (int32)channels[i]);
+    chars_out = snprintf(pc, size, "%6ld ", (int32)Channels[i]);
     pc += chars_out;
     size -= chars_out;
   }
   if (nc) snprintf(pc, size, "   max_width %ld\r\n", (int32)max_width);
   USB_serial_UartPutString(outbuf);   
-  return 10000;
+}
+
+// Printing is left to the main loop so the capture interrupts are not
+// held off while the report goes out
+uint16 ppm_monitor(volatile int32 channels[])
+{
+  (void)channels;
+  task_post(TASK_REPORT);
+  proto_clock_at(proto_clock_deadline() + 310000);
+  return 0;
+}
+
+static void proto_build_task(void) {
+  proto_engine_prepare(&proto_active, Channels);
+}
+
+// proto_timer counts up from zero at 1MHz after each terminal count, so the
+// counter is the time spent since the protocol callback was entered
+static uint16 proto_elapsed_us(void) {
+  return proto_timer_ReadCounter();
+}
+
+// SymaX on channels 1-8 and CX10 on channels 9-16 sharing the radio
+static void multi_init(uint8 tx_addr[]) {
+  proto_sched_reset(proto_elapsed_us);
+  Channels[8+THROTTLE] = CHAN_MIN_VALUE;
+  proto_sched_add(&symax_desc, 0, 0, tx_addr);
+  proto_sched_add(&cx10_desc, FORMAT_CX10_BLUE, 8, tx_addr);
+}
+
+static void multi_report(void) {
+  proto_sched_entry *e;
+  uint8 i;
+
+  for (i = 0; i < proto_sched_count; i++) {
+    e = &proto_sched[i];
+    USB_serial_UartPutString(e->inst.desc->name);
+    printd(" slots %lu", e->slots);
+    printd(" packets %lu", e->inst.packets);
+    printd(" collisions %lu", e->collisions);
+    printd(" missed %lu", e->deadline_misses);
+    printd(" overruns %lu", e->overruns);
+    printd(" held %lu", e->held);
+    printd(" max late %luus", e->max_late);
+    printd(" max exec %luus\r\n", e->max_exec);
+  }
 }
 
 int main() {
   uint8 led = 0;
   uint8 ch;
+  uint8 yd717_format = 0;
+  uint8 cx10_format = FORMAT_CX10_BLUE;
   
   CyGlobalIntEnable; /* enable global interrupts. */
 
   DUT_reset();
   nRF_SPI_Start();
   USB_serial_Start();
+  idle_start();
   DUT_SPI_Start();
+  timebase_start();
+  task_set(TASK_BUILD, proto_build_task);
+  task_set(TASK_REPORT, ppm_report);
+  mixer_preset();
+  proto_engine_defer = 1;
   proto_timer_int_StartEx(proto_timer_interrupt_service);
   proto_timer_Start();
+  settings_load();
 
 
  
   for(;;) {
+    if (!USB_serial_SpiUartGetRxBufferSize())
+      idle_wait();
 
     /* Get received character or zero if nothing has been received yet */
     ch = USB_serial_UartGetChar(); 
@@ -336,12 +679,16 @@ int main() {
   
     switch(ch) {
     case '1':
-      USB_serial_UartPutString("Running YD717\r\n");
-      proto_run(yd717_init, yd717_callback);
+      USB_serial_UartPutString("Running ");
+      USB_serial_UartPutString(yd717_desc.formats[yd717_format]);
+      USB_serial_UartPutString("\r\n");
+      proto_engine_select(&yd717_desc, yd717_format);
+      proto_run_engine();
       break;
     case '2':
       USB_serial_UartPutString("Running SymaX\r\n");
-      proto_run(symax_init, symax_callback);
+      proto_engine_select(&symax_desc, 0);
+      proto_run_engine();
       break;
     case '3':
       USB_serial_UartPutString("symax_capture start\r\n");
@@ -352,17 +699,16 @@ int main() {
       symax_bind32();
       break;      
     case '5':
-      USB_serial_UartPutString("Running CX10A with capture\r\n");
-      proto_run(cx10_init, cx10_callback);
+      USB_serial_UartPutString("Running ");
+      USB_serial_UartPutString(cx10_desc.formats[cx10_format]);
+      USB_serial_UartPutString(settings.cx10_bound ? " with saved id\r\n" : " with capture\r\n");
+      proto_engine_select(&cx10_desc, cx10_format);
+      proto_run_engine();
       read_xn297();
       break;
     case '6':
       USB_serial_UartPutString("PPM monitor - pulse width in microseconds\r\n");
-      ppm_timer_Stop();
-      ppm_timer_SetCaptureMode(ppm_timer_TRIG_FALLING);
-      ppm_timer_int_StartEx(ppm_timer_interrupt_service);
-      number_of_channels = 0;
-      ppm_timer_Start();
+      ppm_capture_start();
       proto_run(NULL, ppm_monitor);
       break;    
     case '7':
@@ -374,6 +720,47 @@ int main() {
       ppm_timer_Start();
       proto_run(NULL, ppm_monitor);
       break;    
+    case '8':
+      USB_serial_UartPutString("symax_verify start\r\n");
+      symax_verify();
+      break;
+    case '9':
+      USB_serial_UartPutString("Running SymaX + CX10A time shared, CX10A on channels 9-16\r\n");
+      proto_run(multi_init, proto_sched_callback);
+      multi_report();
+      break;
+    case 'y':
+      yd717_format = (yd717_format + 1) % yd717_desc.num_formats;
+      USB_serial_UartPutString("YD717 format ");
+      USB_serial_UartPutString(yd717_desc.formats[yd717_format]);
+      USB_serial_UartPutString("\r\n");
+      break;
+    case 'c':
+      cx10_format = (cx10_format + 1) % cx10_desc.num_formats;
+      USB_serial_UartPutString("CX10 format ");
+      USB_serial_UartPutString(cx10_desc.formats[cx10_format]);
+      USB_serial_UartPutString("\r\n");
+      break;
+    case 'p':
+      ppm_bridge ^= 1;
+      USB_serial_UartPutString(ppm_bridge ? "PPM input (AETR order) drives protocols\r\n"
+                                          : "keyboard drives protocols\r\n");
+      break;
+    case 'm':
+      proto_engine_mix = proto_engine_mix ? NULL : mixer_run;
+      USB_serial_UartPutString(proto_engine_mix ? "mixer on\r\n" : "mixer off\r\n");
+      break;
+    case 'g':
+      if (wavegen_active())
+        wavegen_reset();
+      else
+        wavegen_preset();
+      USB_serial_UartPutString(wavegen_active() ? "waveform generator on\r\n" : "waveform generator off\r\n");
+      break;
+    case 'x':
+      cx10_forget_bind();
+      USB_serial_UartPutString("CX10A aircraft id cleared\r\n");
+      break;
     case 'l':
       P1_6_Write(led ^= 1);
       break;
@@ -385,9 +772,19 @@ int main() {
       USB_serial_UartPutString("2 - bind symax\r\n");
       USB_serial_UartPutString("3 - symax capture\r\n");
       USB_serial_UartPutString("4 - symax bind 32\r\n");
-      USB_serial_UartPutString("5 - bind CX10A\r\n");
+      USB_serial_UartPutString("5 - bind CX10\r\n");
       USB_serial_UartPutString("6 - PPM monitor\r\n"); 
       USB_serial_UartPutString("7 - PWM monitor\r\n");      
+      USB_serial_UartPutString("8 - symax verify hop table\r\n");
+      USB_serial_UartPutString("9 - symax + cx10A time shared\r\n");
+      USB_serial_UartPutString("y - next yd717 format (f while running)\r\n");
+      USB_serial_UartPutString("    while running: t - timing stats, z - clear stats\r\n");
+      USB_serial_UartPutString("                   b - build packets in main loop/interrupt\r\n");
+      USB_serial_UartPutString("c - next cx10 format\r\n");
+      USB_serial_UartPutString("x - forget cx10A aircraft id\r\n");
+      USB_serial_UartPutString("p - PPM input drives 1, 2 and 5 on/off\r\n");
+      USB_serial_UartPutString("m - mixer expo/throttle curve on/off\r\n");
+      USB_serial_UartPutString("g - stick waveform generator on/off\r\n");
       USB_serial_UartPutString("r - reset\r\n");
       USB_serial_UartPutString("l - led\r\n");
       break;
@@ -0,0 +1,125 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "mixer.h"
+
+#define RANGE      10000
+#define LUT_STEP     625              // input span of one table segment
+
+mixer_output mixer[MIXER_OUTPUTS];
+
+
+// One to one, 100%, full range
+void mixer_reset(void)
+{
+    uint8 i, t;
+
+    memset(mixer, 0, sizeof(mixer));
+    for (i = 0; i < MIXER_OUTPUTS; i++) {
+        for (t = 0; t < MIXER_TERMS; t++)
+            mixer[i].term[t].src = MIXER_UNUSED;
+        mixer[i].term[0].src = i;
+        mixer[i].term[0].weight = 1024;
+        mixer[i].min = -RANGE;
+        mixer[i].max = RANGE;
+    }
+}
+
+void mixer_set_term(uint8 out, uint8 term, uint8 src, int16 percent)
+{
+    if (out >= MIXER_OUTPUTS || term >= MIXER_TERMS) return;
+    mixer[out].term[term].src = src < MIXER_INPUTS ? src : MIXER_UNUSED;
+    mixer[out].term[term].weight = (int32)percent * 1024 / 100;
+}
+
+// y = x * (1 - e) + e * x^3, 0 turns the table off
+void mixer_set_expo(uint8 out, int8 percent)
+{
+    int64_t x;
+    uint8 i;
+
+    if (out >= MIXER_OUTPUTS) return;
+    mixer[out].use_lut = percent != 0;
+    for (i = 0; i < MIXER_LUT_SIZE; i++) {
+        x = (int32)i * LUT_STEP - RANGE;
+        mixer[out].lut[i] = (x * (100 - percent)
+                             + percent * x * x * x / ((int64_t)RANGE * RANGE)) / 100;
+    }
+}
+
+// 5 or 9 evenly spaced points from -10000 to 10000 input.  Returns 0 and
+// leaves the output unchanged for any other count.
+uint8 mixer_set_curve(uint8 out, const int16 points[], uint8 num)
+{
+    int32 step, x, seg;
+    uint8 i;
+
+    if (out >= MIXER_OUTPUTS || (num != 5 && num != 9)) return 0;
+    step = 2 * RANGE / (num - 1);
+    for (i = 0; i < MIXER_LUT_SIZE; i++) {
+        x = (int32)i * LUT_STEP;
+        seg = x / step;
+        if (seg >= num - 1) seg = num - 2;
+        mixer[out].lut[i] = points[seg]
+                            + (points[seg + 1] - points[seg]) * (x - seg * step) / step;
+    }
+    mixer[out].use_lut = 1;
+    return 1;
+}
+
+void mixer_set_limits(uint8 out, int16 subtrim, int16 min, int16 max, uint8 reverse)
+{
+    if (out >= MIXER_OUTPUTS) return;
+    mixer[out].subtrim = subtrim;
+    mixer[out].min = min;
+    mixer[out].max = max;
+    mixer[out].reverse = reverse;
+}
+
+// Input scaled by 32768/20000 (6711/4096) so segment and fraction are
+// bit fields: 5 bits of segment, 10 bits of fraction.
+static int32 lut_eval(const int16 lut[], int32 x)
+{
+    uint32 u = ((uint32)(x + RANGE) * 6711) >> 12;
+    uint32 seg = u >> 10;
+    int32 frac = u & 1023;
+
+    if (seg >= MIXER_LUT_SIZE - 1) return lut[MIXER_LUT_SIZE - 1];
+    return lut[seg] + (((lut[seg + 1] - lut[seg]) * frac) >> 10);
+}
+
+void mixer_run(volatile int32 in[], int32 out[])
+{
+    const mixer_output *m;
+    int32 value;
+    uint8 i, t;
+
+    for (i = 0; i < MIXER_OUTPUTS; i++) {
+        m = &mixer[i];
+        value = 0;
+        for (t = 0; t < MIXER_TERMS; t++)
+            if (m->term[t].src != MIXER_UNUSED)
+                value += (in[m->term[t].src] * m->term[t].weight) >> 10;
+
+        if (value > RANGE) value = RANGE;
+        if (value < -RANGE) value = -RANGE;
+        if (m->use_lut) value = lut_eval(m->lut, value);
+        if (m->reverse) value = -value;
+        value += m->subtrim;
+        if (value > m->max) value = m->max;
+        if (value < m->min) value = m->min;
+        out[i] = value;
+    }
+}
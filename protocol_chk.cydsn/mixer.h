@@ -0,0 +1,55 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _MIXER_H_
+#define _MIXER_H_
+
+#include "proto_engine.h"
+
+// Fixed-point mixer between the input channels and the protocol packet.
+// Each output is a weighted sum of inputs, shaped by an expo or curve
+// table, then reversed, offset by subtrim and limited to its endpoints.
+// Setup may divide; mixer_run only multiplies and shifts so it is cheap
+// enough for every packet.  Values use the protocol range -10000..10000.
+
+#define MIXER_INPUTS     PROTO_NUM_CHANNELS
+#define MIXER_OUTPUTS    PROTO_NUM_CHANNELS
+#define MIXER_TERMS      4
+#define MIXER_LUT_SIZE  33            // 32 segments of 625 across the range
+#define MIXER_UNUSED  0xff            // term source for an empty term
+
+typedef struct {
+    uint8  src;
+    int16  weight;                    // 1024 = 100%
+} mixer_term;
+
+typedef struct {
+    mixer_term term[MIXER_TERMS];
+    uint8  use_lut;
+    uint8  reverse;
+    int16  subtrim;
+    int16  min;                       // endpoints
+    int16  max;
+    int16  lut[MIXER_LUT_SIZE];
+} mixer_output;
+
+extern mixer_output mixer[MIXER_OUTPUTS];
+
+void mixer_reset(void);
+void mixer_set_term(uint8 out, uint8 term, uint8 src, int16 percent);
+void mixer_set_expo(uint8 out, int8 percent);
+uint8 mixer_set_curve(uint8 out, const int16 points[], uint8 num);
+void mixer_set_limits(uint8 out, int16 subtrim, int16 min, int16 max, uint8 reverse);
+void mixer_run(volatile int32 in[], int32 out[]);
+
+#endif
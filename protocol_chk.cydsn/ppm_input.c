@@ -0,0 +1,89 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ppm_input.h"
+#include "protocols.h"
+#include "timebase.h"
+
+static ppm_frame frames[2];
+static volatile uint8 front = 2;      // frame readers use, 2 before the first
+static uint8 back;                    // frame being filled
+static uint8 pos;
+static uint8 expected;                // channels in the last frame, 0 if unknown
+static uint8 published;               // current frame already published
+static uint32 seq;
+
+
+void ppm_input_reset(void)
+{
+    front = 2;
+    back = 0;
+    pos = 0;
+    expected = 0;
+    published = 0;
+}
+
+static void publish(void)
+{
+    ppm_frame *f = &frames[back];
+
+    f->num = pos;
+    f->stamp = timebase_us();
+    f->seq = ++seq;
+    expected = pos;
+    published = 1;
+    front = back;
+    back ^= 1;
+}
+
+// Called from the capture interrupt with each pulse width.  A frame is
+// published as soon as it has as many channels as the last one rather
+// than at the next sync, which saves the length of the frame gap.
+void ppm_input_pulse(uint32 width)
+{
+    if (width > PPM_SYNC_US) {
+        if (pos && !published) publish();
+        pos = 0;
+        published = 0;
+        return;
+    }
+    if (published) {
+        // more channels than last frame, publish the next one at sync
+        expected = 0;
+        return;
+    }
+    if (pos >= PPM_MAX_CHANS) return;
+
+    frames[back].width[pos++] = width;
+    if (pos == expected) publish();
+}
+
+// NULL until a frame has been received.  The returned frame is not
+// refilled until the next one has been published, about a frame time,
+// far longer than a reader needs to copy it.
+const ppm_frame *ppm_input_latest(void)
+{
+    uint8 i = front;
+    return i < 2 ? &frames[i] : NULL;
+}
+
+// 1000..2000us to the -10000..10000 range the protocols expect
+int32 ppm_to_proto(uint16 width)
+{
+    int32 value = ((int32)width - 1500) * 20;
+
+    if (value > CHAN_MAX_VALUE) value = CHAN_MAX_VALUE;
+    if (value < CHAN_MIN_VALUE) value = CHAN_MIN_VALUE;
+    return value;
+}
@@ -0,0 +1,38 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _PPM_INPUT_H_
+#define _PPM_INPUT_H_
+
+#include <project.h>
+
+// PPM frames decoded by the capture interrupt and published whole through
+// a double buffer.  The interrupt fills the back frame and publishes it by
+// switching one index, so a reader always sees a complete frame.
+
+#define PPM_MAX_CHANS   16
+#define PPM_SYNC_US   3000      // longer pulses are the frame gap
+
+typedef struct {
+    uint32 seq;                 // frames published before this one, plus one
+    uint32 stamp;               // timebase_us() when the frame completed
+    uint8  num;
+    uint16 width[PPM_MAX_CHANS];    // us
+} ppm_frame;
+
+void ppm_input_reset(void);
+void ppm_input_pulse(uint32 width);
+const ppm_frame *ppm_input_latest(void);
+int32 ppm_to_proto(uint16 width);
+
+#endif
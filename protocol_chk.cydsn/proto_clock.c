@@ -0,0 +1,102 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "proto_clock.h"
+
+volatile uint32 proto_clock_misses;
+volatile uint32 proto_clock_splits;
+
+static volatile uint8 restart = 1;
+static uint32 tick_time;              // time of the terminal count being serviced
+static uint32 step;                   // period programmed for the current count
+static uint32 deadline;               // nominal time of the next callback
+static uint8 deadline_set;
+
+
+void proto_clock_reset(void)
+{
+    restart = 1;
+}
+
+uint32 proto_clock_deadline(void)
+{
+    return deadline;
+}
+
+// proto_timer counts up from zero at 1MHz after each terminal count
+uint32 proto_clock_now(void)
+{
+    return tick_time + proto_timer_ReadCounter();
+}
+
+void proto_clock_at(uint32 at)
+{
+    deadline = at;
+    deadline_set = 1;
+}
+
+// Called from the timer interrupt.  Returns the number of us until the
+// next terminal count; the timer period register takes one less.
+uint16 proto_clock_tick(uint16 (*callback)(volatile int32 channels[]), volatile int32 channels[])
+{
+    int32 remaining;
+    uint16 period = 0;
+    uint32 skipped;
+
+    if (restart) {
+        restart = 0;
+        tick_time = 0;
+        deadline = 0;
+        proto_clock_misses = 0;
+        proto_clock_splits = 0;
+    } else {
+        tick_time += step;
+    }
+
+    if ((int32)(deadline - tick_time) > 0) {
+        // intermediate count of a wait longer than one timer period
+        proto_clock_splits += 1;
+    } else {
+        if ((int32)(tick_time - deadline) > PROTO_CLOCK_RESYNC)
+            deadline = tick_time;
+        deadline_set = 0;
+        period = callback ? callback(channels) : 1000;
+        if (deadline_set)
+            period = 0;
+        else
+            deadline += period;
+    }
+
+    remaining = (int32)(deadline - proto_clock_now());
+    if (remaining < PROTO_CLOCK_MIN_LEAD && period) {
+        // callback overran its next deadline: drop the periods already
+        // passed rather than run them back to back, keeping the cadence
+        skipped = (PROTO_CLOCK_MIN_LEAD - remaining + period - 1) / period;
+        deadline += skipped * period;
+        remaining += skipped * period;
+        proto_clock_misses += skipped;
+    }
+    if (remaining < PROTO_CLOCK_MIN_LEAD) {
+        // an absolute deadline already passed, or entered too late to
+        // program the last piece of a split wait: as soon as possible
+        proto_clock_misses += 1;
+        step = proto_timer_ReadCounter() + PROTO_CLOCK_MIN_LEAD;
+    } else {
+        step = deadline - tick_time;
+        // split long waits so the last piece is never too short to program
+        if (step > PROTO_CLOCK_MAX_STEP)
+            step = step - PROTO_CLOCK_MAX_STEP < PROTO_CLOCK_MAX_STEP / 2 ? step / 2 : PROTO_CLOCK_MAX_STEP;
+    }
+    return step;
+}
@@ -0,0 +1,41 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _PROTO_CLOCK_H_
+#define _PROTO_CLOCK_H_
+
+#include <project.h>
+
+// Absolute deadline scheduling on proto_timer.  The 32-bit time base is the
+// sum of the periods programmed into the timer, so it advances with the
+// hardware count and never accumulates interrupt latency.  A callback's
+// return value is the time from its own deadline to the next, not from when
+// it ran, so late packets do not shift the cadence.  A callback that runs
+// past its next deadline loses the periods it overran, as proto_sched does.
+
+#define PROTO_CLOCK_MAX_STEP   60000   // longest single timer period in us
+#define PROTO_CLOCK_MIN_LEAD      20   // us needed to reprogram the timer safely
+#define PROTO_CLOCK_RESYNC    100000   // give up catching up when this far behind
+
+extern volatile uint32 proto_clock_misses;   // periods skipped, their deadline passed before it was programmed
+extern volatile uint32 proto_clock_splits;   // extra timer periods for long waits
+
+void   proto_clock_reset(void);
+uint16 proto_clock_tick(uint16 (*callback)(volatile int32 channels[]), volatile int32 channels[]);
+
+// Only valid inside the callback
+uint32 proto_clock_deadline(void);
+uint32 proto_clock_now(void);
+void   proto_clock_at(uint32 deadline);
+
+#endif
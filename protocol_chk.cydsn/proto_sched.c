@@ -0,0 +1,150 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "proto_sched.h"
+
+proto_sched_entry proto_sched[PROTO_SCHED_MAX];
+uint8 proto_sched_count;
+
+static uint32 sched_now;              // scheduler time of the current tick in us
+static uint8 sched_last;              // instance that last used the radio
+static uint16 (*sched_elapsed)(void); // us since the tick started, may be NULL
+
+#define NO_INSTANCE 0xff
+
+
+void proto_sched_reset(uint16 (*elapsed_us)(void))
+{
+    memset(proto_sched, 0, sizeof(proto_sched));
+    proto_sched_count = 0;
+    sched_now = 0;
+    sched_last = 0xff;
+    sched_elapsed = elapsed_us;
+}
+
+// Returns the instance index or -1 if the table is full or the protocol
+// is already running
+int8 proto_sched_add(const proto_desc *desc, uint8 format, uint8 chan_base, uint8 tx_addr[])
+{
+    proto_sched_entry *e;
+    uint8 i;
+
+    if (proto_sched_count >= PROTO_SCHED_MAX) return -1;
+    for (i = 0; i < proto_sched_count; i++)
+        if (proto_sched[i].inst.desc == desc) return -1;
+
+    e = &proto_sched[proto_sched_count];
+    proto_engine_start(&e->inst, desc, format, tx_addr);
+    e->chan_base = chan_base;
+    // stagger the first packets so instances start in separate slots
+    e->due = sched_now + (uint32)proto_sched_count * PROTO_SCHED_SLOT;
+    sched_last = proto_sched_count;     // init left the radio set up for this one
+    return proto_sched_count++;
+}
+
+static uint8 listener(void)
+{
+    const proto_instance *p;
+    uint8 i;
+
+    for (i = 0; i < proto_sched_count; i++) {
+        p = &proto_sched[i].inst;
+        if (p->desc->phases[p->phase].listen)
+            return i;
+    }
+    return NO_INSTANCE;
+}
+
+static void run_slot(uint8 run, volatile int32 channels[])
+{
+    proto_sched_entry *e = &proto_sched[run];
+    int32 late;
+    uint16 period, used;
+
+    late = (int32)(sched_now - e->due);
+    if (late > 0) {
+        e->collisions += 1;
+        if (late > PROTO_SCHED_LATE_MAX) e->deadline_misses += 1;
+        if (late > e->max_late) e->max_late = late > 0xffff ? 0xffff : late;
+    }
+
+    if (run != sched_last && e->inst.desc->resume)
+        e->inst.desc->resume(&e->inst);
+    sched_last = run;
+
+    period = proto_engine_run(&e->inst, &channels[e->chan_base]);
+    e->slots += 1;
+
+    if (sched_elapsed) {
+        used = sched_elapsed();
+        if (used > e->max_exec) e->max_exec = used;
+        if (used > PROTO_SCHED_SLOT) e->overruns += 1;
+    }
+
+    e->due += period;
+    // more than a whole period behind: drop the backlog rather than burst
+    if ((int32)(sched_now - e->due) > 0)
+        e->due = sched_now + period;
+}
+
+// Earliest deadline first.  Ties go to the lower index.  An instance that
+// comes due while another holds the radio runs in the next free slot but
+// keeps its own cadence, so one collision does not shift later packets.
+uint16 proto_sched_callback(volatile int32 channels[])
+{
+    proto_sched_entry *e;
+    uint32 next;
+    uint8 i, run = 0, hold;
+
+    if (!proto_sched_count)
+        return 1000;
+
+    hold = listener();
+    if (hold == NO_INSTANCE) {
+        for (i = 1; i < proto_sched_count; i++)
+            if ((int32)(proto_sched[i].due - proto_sched[run].due) < 0) run = i;
+        run_slot(run, channels);
+    } else {
+        // the others give up their slots, keeping their cadence
+        for (i = 0; i < proto_sched_count; i++) {
+            e = &proto_sched[i];
+            while (i != hold && (int32)(sched_now - e->due) >= 0) {
+                e->due += e->inst.period;
+                e->held += 1;
+            }
+        }
+        if ((int32)(proto_sched[hold].due - sched_now) <= 0)
+            run_slot(hold, channels);
+    }
+
+    next = proto_sched[0].due;
+    for (i = 1; i < proto_sched_count; i++)
+        if ((int32)(proto_sched[i].due - next) < 0) next = proto_sched[i].due;
+
+    next -= sched_now;
+    if ((int32)next < PROTO_SCHED_SLOT) next = PROTO_SCHED_SLOT;
+    if (next > 0xffff) next = 0xffff;
+    sched_now += next;
+    return next;
+}
+
+// Called from the main loop for work too slow for interrupt context
+void proto_sched_background(void)
+{
+    uint8 i;
+
+    for (i = 0; i < proto_sched_count; i++)
+        if (proto_sched[i].inst.desc->background)
+            proto_sched[i].inst.desc->background(&proto_sched[i].inst);
+}
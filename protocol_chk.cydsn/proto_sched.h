@@ -0,0 +1,54 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _PROTO_SCHED_H_
+#define _PROTO_SCHED_H_
+
+#include "proto_engine.h"
+
+// Time-division scheduler sharing one radio between several protocol
+// instances, each with its own packet period.  Protocol modules keep their
+// state in file statics so each instance must use a different protocol.
+//
+// An instance in a listen phase, such as CX-10A binding, waits for a reply
+// between its packets; another instance's packet would switch the radio
+// back to TX and clear the reply.  It holds the radio for the whole phase
+// and the others skip their slots until it moves on, so they stay silent
+// for as long as the aircraft takes to answer.
+
+#define PROTO_SCHED_MAX         3
+#define PROTO_SCHED_SLOT      800     // us reserved on the radio for one packet
+#define PROTO_SCHED_LATE_MAX  500     // us late before a packet counts as a deadline miss
+
+typedef struct {
+    proto_instance inst;
+    uint8  chan_base;                 // first input channel used by this instance
+    uint32 due;                       // scheduler time of next packet in us
+    uint32 slots;                     // callbacks run
+    uint32 collisions;                // slots delayed by another instance
+    uint32 deadline_misses;           // slots more than PROTO_SCHED_LATE_MAX late
+    uint32 overruns;                  // callbacks longer than PROTO_SCHED_SLOT
+    uint32 held;                      // slots skipped while another instance listened
+    uint16 max_late;                  // worst lateness in us
+    uint16 max_exec;                  // longest callback in us
+} proto_sched_entry;
+
+extern proto_sched_entry proto_sched[PROTO_SCHED_MAX];
+extern uint8 proto_sched_count;
+
+void   proto_sched_reset(uint16 (*elapsed_us)(void));
+int8   proto_sched_add(const proto_desc *desc, uint8 format, uint8 chan_base, uint8 tx_addr[]);
+uint16 proto_sched_callback(volatile int32 channels[]);
+void   proto_sched_background(void);
+
+#endif
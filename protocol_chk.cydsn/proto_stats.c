@@ -0,0 +1,125 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include "proto_stats.h"
+#include "timebase.h"
+
+static proto_stats_data stats;
+static volatile uint32 stats_seq;     // bumped by every interrupt that updates stats
+static volatile uint8 reset_request;
+static uint32 entry_time;
+static uint32 last_entry;
+static uint16 last_period;            // 0 until an interval can be measured
+
+
+static void time_add(proto_stats_time *t, uint32 us)
+{
+    if (us > 0xffff) us = 0xffff;
+    if (t->count == 0 || us < t->min) t->min = us;
+    if (us > t->max) t->max = us;
+    t->count += 1;
+    t->total += us;
+}
+
+static uint8 jitter_bin(uint32 us)
+{
+    uint8 bin = 0;
+
+    while (us && bin < PROTO_STATS_BINS - 1) {
+        us >>= 1;
+        bin += 1;
+    }
+    return bin;
+}
+
+// Called first thing in the timer interrupt
+void proto_stats_enter(void)
+{
+    int32 jitter;
+
+    entry_time = timebase_us();
+
+    if (reset_request) {
+        reset_request = 0;
+        memset(&stats, 0, sizeof(stats));
+        last_period = 0;
+    }
+
+    if (last_period) {
+        time_add(&stats.interval, entry_time - last_entry);
+        jitter = (int32)(entry_time - last_entry) - last_period;
+        if (stats.interval.count == 1 || jitter < stats.jitter_min) stats.jitter_min = jitter;
+        if (stats.interval.count == 1 || jitter > stats.jitter_max) stats.jitter_max = jitter;
+        stats.jitter[jitter_bin(jitter < 0 ? -jitter : jitter)] += 1;
+    }
+    last_entry = entry_time;
+}
+
+// Called last in the timer interrupt with the phase the callback ran in
+// and the period it returned
+void proto_stats_exit(uint8 phase, uint16 period)
+{
+    if (phase >= PROTO_STATS_PHASES) phase = PROTO_STATS_PHASES - 1;
+    time_add(&stats.exec[phase], timebase_us() - entry_time);
+    last_period = period;
+    stats_seq += 1;
+}
+
+// Cleared by the interrupt so the main loop never writes live stats
+void proto_stats_reset(void)
+{
+    reset_request = 1;
+}
+
+static void print_time(const char *name, const proto_stats_time *t)
+{
+    char outbuf[80];
+
+    if (!t->count) return;
+    snprintf(outbuf, sizeof(outbuf), "%s n %lu min %u max %u mean %lu\r\n",
+             name, t->count, t->min, t->max, t->total / t->count);
+    USB_serial_UartPutString(outbuf);
+}
+
+// Takes a consistent copy without masking the interrupt, then prints it
+void proto_stats_report(void)
+{
+    proto_stats_data copy;
+    uint32 seq;
+    char outbuf[40];
+    uint8 i;
+
+    do {
+        seq = stats_seq;
+        memcpy(&copy, &stats, sizeof(copy));
+    } while (seq != stats_seq);
+
+    print_time("interval", &copy.interval);
+    if (!copy.interval.count) return;
+    snprintf(outbuf, sizeof(outbuf), "jitter min %ld max %ld\r\n", copy.jitter_min, copy.jitter_max);
+    USB_serial_UartPutString(outbuf);
+    for (i = 0; i < PROTO_STATS_BINS; i++) {
+        if (!copy.jitter[i]) continue;
+        if (i == PROTO_STATS_BINS - 1)
+            snprintf(outbuf, sizeof(outbuf), ">=%5u us %lu\r\n", 1u << (i - 1), copy.jitter[i]);
+        else
+            snprintf(outbuf, sizeof(outbuf), " <%5u us %lu\r\n", 1u << i, copy.jitter[i]);
+        USB_serial_UartPutString(outbuf);
+    }
+    for (i = 0; i < PROTO_STATS_PHASES; i++) {
+        snprintf(outbuf, sizeof(outbuf), "exec phase %u", i);
+        print_time(outbuf, &copy.exec[i]);
+    }
+}
@@ -0,0 +1,46 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _PROTO_STATS_H_
+#define _PROTO_STATS_H_
+
+#include <project.h>
+
+// Timing of the protocol timer callback.  Entry and exit are timestamped
+// with timebase_us(); intervals are compared with the period the previous
+// callback asked for.
+
+#define PROTO_STATS_PHASES   8      // phases tracked, later ones share the last slot
+#define PROTO_STATS_BINS    12      // |jitter| histogram: 0, 1, 2-3, 4-7 ... >= 1024 us
+
+typedef struct {
+    uint32 count;
+    uint32 total;                   // us, for the mean
+    uint16 min;
+    uint16 max;
+} proto_stats_time;
+
+typedef struct {
+    proto_stats_time interval;      // entry to entry
+    uint32 jitter[PROTO_STATS_BINS];
+    int32  jitter_min;
+    int32  jitter_max;
+    proto_stats_time exec[PROTO_STATS_PHASES];
+} proto_stats_data;
+
+void proto_stats_enter(void);
+void proto_stats_exit(uint8 phase, uint16 period);
+void proto_stats_reset(void);
+void proto_stats_report(void);
+
+#endif
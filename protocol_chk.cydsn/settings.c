@@ -0,0 +1,68 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <project.h>
+#include "settings.h"
+
+#define SETTINGS_SIMPLE_MODE    1u
+#define SETTINGS_WEAR_LEVELING  2u
+#define SETTINGS_REDUNDANT_COPY 0u
+
+settings_data settings;
+
+// Flash area backing the emulated EEPROM, must be row aligned
+static const uint8 settings_storage[CY_EM_EEPROM_GET_PHYSICAL_SIZE(sizeof(settings_data),
+                                        SETTINGS_SIMPLE_MODE,
+                                        SETTINGS_WEAR_LEVELING,
+                                        SETTINGS_REDUNDANT_COPY)]
+    CY_ALIGN(CY_EM_EEPROM_FLASH_SIZEOF_ROW) = {0u};
+
+static cy_stc_eeprom_context_t settings_context;
+static uint8 settings_ready;
+
+
+static uint8 settings_start(void)
+{
+    cy_stc_eeprom_config_t config;
+
+    if (settings_ready) return 1;
+
+    config.eepromSize = sizeof(settings_data);
+    config.simpleMode = SETTINGS_SIMPLE_MODE;
+    config.wearLevelingFactor = SETTINGS_WEAR_LEVELING;
+    config.redundantCopy = SETTINGS_REDUNDANT_COPY;
+    config.blockingWrite = 1u;
+    config.userFlashStartAddr = (uint32)settings_storage;
+
+    settings_ready = Cy_Em_EEPROM_Init(&config, &settings_context) == CY_EM_EEPROM_SUCCESS;
+    return settings_ready;
+}
+
+void settings_load(void)
+{
+    if (!settings_start()
+     || Cy_Em_EEPROM_Read(0, &settings, sizeof(settings), &settings_context) != CY_EM_EEPROM_SUCCESS
+     || settings.magic != SETTINGS_MAGIC) {
+        memset(&settings, 0, sizeof(settings));
+        settings.magic = SETTINGS_MAGIC;
+    }
+}
+
+void settings_save(void)
+{
+    if (!settings_start()) return;
+    settings.magic = SETTINGS_MAGIC;
+    if (Cy_Em_EEPROM_Write(0, &settings, sizeof(settings), &settings_context) != CY_EM_EEPROM_SUCCESS)
+        USB_serial_UartPutString("settings write failed\r\n");
+}
@@ -0,0 +1,36 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+#include <project.h>
+
+// Bump SETTINGS_MAGIC when the layout changes so old flash reads as blank
+#define SETTINGS_MAGIC  0x52540001ul
+
+typedef struct {
+    uint32 magic;
+    uint8  cx10_bound;            // nonzero when cx10 fields below are valid
+    uint8  cx10_format;           // format the aircraft was bound with
+    uint8  cx10_txid[4];
+    uint8  cx10_aircraft_id[4];   // returned by CX-10A during bind
+} settings_data;
+
+extern settings_data settings;
+
+// Both may block for a flash row write - call from main loop only
+void settings_load(void);
+void settings_save(void);
+
+#endif
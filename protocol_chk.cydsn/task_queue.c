@@ -0,0 +1,51 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "task_queue.h"
+
+static void (*tasks[TASK_MAX])(void);
+static volatile uint8 pending;
+
+
+void task_set(uint8 prio, void (*fn)(void))
+{
+    if (prio < TASK_MAX) tasks[prio] = fn;
+}
+
+void task_post(uint8 prio)
+{
+    uint8 intr;
+
+    if (prio >= TASK_MAX) return;
+    intr = CyEnterCriticalSection();
+    pending |= 1 << prio;
+    CyExitCriticalSection(intr);
+}
+
+// Runs the highest priority pending task.  Returns 0 when none was pending.
+uint8 task_run(void)
+{
+    uint8 intr, prio;
+
+    if (!pending) return 0;
+
+    intr = CyEnterCriticalSection();
+    for (prio = 0; !(pending & (1 << prio)); prio++)
+        ;
+    pending &= ~(1 << prio);
+    CyExitCriticalSection(intr);
+
+    if (tasks[prio]) tasks[prio]();
+    return 1;
+}
@@ -0,0 +1,29 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _TASK_QUEUE_H_
+#define _TASK_QUEUE_H_
+
+#include <project.h>
+
+// Run-to-completion tasks posted from interrupts and run from the main
+// loop.  A task is identified by its priority, 0 highest, and posting it
+// again before it runs has no further effect.
+
+#define TASK_MAX  8
+
+void  task_set(uint8 prio, void (*fn)(void));
+void  task_post(uint8 prio);
+uint8 task_run(void);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timebase.h"
+#include "ticks.h"
+
+#define ICSR_PENDSTSET  (1UL << 26)     // SysTick exception pending
+
+#define TICK_CYCLES  (CYDEV_BCLK__SYSCLK__HZ / 1000)
+
+// cycles within a tick go through TICKS_TO_US(), which takes 16 bits
+typedef char tick_fits_16_bits[TICK_CYCLES <= 0x10000 ? 1 : -1];
+
+static volatile uint32 timebase_ms;
+
+static void timebase_tick(void)
+{
+    timebase_ms += 1;
+}
+
+// SysTick resets to the highest exception priority so the tick preempts
+// the protocol and capture interrupts that take timestamps.
+void timebase_start(void)
+{
+    CySysTickStart();
+    CySysTickSetReload(TICK_CYCLES - 1);
+    CySysTickClear();
+    CySysTickSetCallback(0, timebase_tick);
+}
+
+uint32 timebase_us(void)
+{
+    uint32 ms, value, reloaded, cycles;
+
+    // retry if the millisecond tick landed between the reads
+    do {
+        ms = timebase_ms;
+        value = CySysTickGetValue();
+        // reloaded but the tick not yet run, as with interrupts masked:
+        // read the counter again after the reload and count it here
+        reloaded = CY_GET_REG32(CYREG_CM0_ICSR) & ICSR_PENDSTSET;
+        if (reloaded)
+            value = CySysTickGetValue();
+    } while (ms != timebase_ms);
+    cycles = TICK_CYCLES - 1 - value;
+    if (reloaded)
+        ms += 1;
+
+    return ms * 1000 + TICKS_TO_US(cycles, CYDEV_BCLK__SYSCLK__HZ);
+}
@@ -0,0 +1,31 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _TIMEBASE_H_
+#define _TIMEBASE_H_
+
+#include <project.h>
+
+// Free-running microsecond clock for timestamps.  This project has no
+// spare timer block so it is built on SysTick: a 1ms interrupt extends the
+// 24-bit down counter.  Wraps after about 71 minutes, so compare times by
+// subtraction only.
+//
+// Safe with interrupts masked, as long as they are not masked for a whole
+// SysTick period: a reload whose tick has not run yet is counted from the
+// pending bit.
+
+void   timebase_start(void);
+uint32 timebase_us(void);
+
+#endif
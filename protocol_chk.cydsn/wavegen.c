@@ -0,0 +1,207 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "wavegen.h"
+#include "protocols.h"
+#include "timebase.h"
+
+// The marker goes to Pin_sigout when the schematic has one, otherwise to
+// the LED pin
+#ifdef CY_PINS_Pin_sigout_H
+#define marker_write(v)  Pin_sigout_Write(v)
+#else
+#define marker_write(v)  P1_6_Write(v)
+#endif
+
+#define EDGE_QUEUE   8                // power of two
+
+typedef struct {
+    uint8  shape;
+    int16  amplitude;
+    int16  offset;
+    uint32 inc;                       // phase step per us, 1/256 units
+    uint32 phase;                     // one cycle is 2^32
+    uint8  frac;
+} wave;
+
+static wave waves[WAVEGEN_CHANNELS];
+static uint8 active;
+static uint8 marker_channel;          // first square channel, WAVEGEN_CHANNELS if none
+static uint8 started;
+static uint32 last_us;
+
+static wavegen_edge edges[EDGE_QUEUE];
+static volatile uint8 edge_head;      // written by the interrupt
+static uint8 edge_tail;
+uint32 wavegen_edges_lost;
+
+// Quarter sine, 64 steps, full scale 32767
+static const int16 sine_lut[65] = {
+        0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+     6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+
+static int32 sine(uint32 phase)
+{
+    uint32 x = (phase >> 14) & 0xffff;   // position in the quarter, 6.10 bits
+    uint8 i;
+    int32 v;
+
+    if (phase & 0x40000000)
+        x = 0x10000 - x;
+    i = x >> 10;
+    v = sine_lut[i];
+    if (i < 64)
+        v += ((sine_lut[i + 1] - v) * (int32)(x & 1023)) >> 10;
+    return phase & 0x80000000 ? -v : v;
+}
+
+// Wave value for a phase, -32767..32767
+static int32 shape_value(uint8 shape, uint32 phase)
+{
+    int32 t = phase >> 16;
+
+    switch (shape) {
+    case WAVE_SINE:     return sine(phase);
+    case WAVE_TRIANGLE: return t < 32768 ? 2 * t - 32767 : 98303 - 2 * t;
+    case WAVE_SAW:      return t - 32767;
+    case WAVE_SQUARE:   return phase & 0x80000000 ? 32767 : -32767;
+    }
+    return 0;
+}
+
+static void recount(void)
+{
+    uint8 i;
+
+    active = 0;
+    marker_channel = WAVEGEN_CHANNELS;
+    for (i = 0; i < WAVEGEN_CHANNELS; i++) {
+        if (waves[i].shape == WAVE_OFF) continue;
+        active += 1;
+        if (waves[i].shape == WAVE_SQUARE && marker_channel == WAVEGEN_CHANNELS)
+            marker_channel = i;
+    }
+}
+
+void wavegen_reset(void)
+{
+    uint8 intr = CyEnterCriticalSection();
+
+    memset(waves, 0, sizeof(waves));
+    recount();
+    started = 0;
+    edge_tail = edge_head;
+    CyExitCriticalSection(intr);
+    marker_write(0);
+}
+
+// Amplitude and offset are in channel units, frequency in 0.01Hz.  The
+// channel restarts at phase zero, the low half for a square wave.
+void wavegen_set(uint8 ch, uint8 shape, int16 amplitude, int16 offset, uint16 freq_chz)
+{
+    wave *w;
+    uint8 intr;
+
+    if (ch >= WAVEGEN_CHANNELS || shape >= WAVE_SHAPES) return;
+    w = &waves[ch];
+    if (freq_chz > WAVEGEN_MAX_CHZ) freq_chz = WAVEGEN_MAX_CHZ;
+
+    intr = CyEnterCriticalSection();
+    w->shape = shape;
+    w->amplitude = amplitude;
+    w->offset = offset;
+    // 2^40 / 10^8 per 0.01Hz without a 64 bit multiply
+    w->inc = freq_chz * 10995 + ((freq_chz * 7620) >> 16);
+    w->phase = 0;
+    w->frac = 0;
+    recount();
+    CyExitCriticalSection(intr);
+}
+
+uint8 wavegen_active(void)
+{
+    return active;
+}
+
+// Called from the protocol timer interrupt before the packet is built,
+// returns 1 when a square wave changed level
+uint8 wavegen_apply(volatile int32 channels[])
+{
+    uint32 now, dt, lo, prev;
+    int32 value;
+    wavegen_edge *e;
+    wave *w;
+    uint8 i, level, edge = 0;
+
+    if (!active) {
+        started = 0;
+        return 0;
+    }
+    now = timebase_us();
+    dt = started ? now - last_us : 0;
+    if (dt > 0xffffff) dt = 0xffffff;
+    last_us = now;
+    started = 1;
+
+    for (i = 0; i < WAVEGEN_CHANNELS; i++) {
+        w = &waves[i];
+        if (w->shape == WAVE_OFF) continue;
+
+        // phase += inc * dt / 256, the whole part may wrap
+        prev = w->phase;
+        lo = (w->inc & 0xff) * dt + w->frac;
+        w->phase += (w->inc >> 8) * dt + (lo >> 8);
+        w->frac = lo & 0xff;
+
+        value = w->offset + ((w->amplitude * shape_value(w->shape, w->phase)) >> 15);
+        if (value > CHAN_MAX_VALUE) value = CHAN_MAX_VALUE;
+        if (value < CHAN_MIN_VALUE) value = CHAN_MIN_VALUE;
+        channels[i] = value;
+
+        level = w->phase >> 31;
+        if (w->shape != WAVE_SQUARE || level == prev >> 31) continue;
+        edge = 1;
+        if (i == marker_channel)
+            marker_write(level);
+        if ((uint8)(edge_head - edge_tail) < EDGE_QUEUE) {
+            e = &edges[edge_head & (EDGE_QUEUE - 1)];
+            e->stamp = now;
+            e->channel = i;
+            e->level = level;
+            edge_head += 1;
+        } else {
+            wavegen_edges_lost += 1;
+        }
+    }
+    return edge;
+}
+
+// Main loop side of the edge queue, returns 0 when empty
+uint8 wavegen_next_edge(wavegen_edge *e)
+{
+    if (edge_tail == edge_head) return 0;
+    *e = edges[edge_tail & (EDGE_QUEUE - 1)];
+    edge_tail += 1;
+    return 1;
+}
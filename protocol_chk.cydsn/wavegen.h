@@ -0,0 +1,54 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _WAVEGEN_H_
+#define _WAVEGEN_H_
+
+#include <project.h>
+
+// Stick waveform generator for receiver tests.  Each channel can follow a
+// sine, triangle, sawtooth or square wave around an offset.  A 32-bit
+// phase accumulator per channel advances by elapsed time every packet, so
+// the waveform stays in real time whatever the protocol period is.
+//
+// Square wave edges are queued with their timebase_us() time and the
+// first square channel is copied to the marker pin.  wavegen_apply()
+// returns 1 on an edge so the caller discards any packet built ahead; the
+// marker then changes in the same interrupt that builds and sends the
+// packet carrying the new value, deferred builds or not.
+
+#define WAVEGEN_CHANNELS    16
+#define WAVEGEN_MAX_CHZ   5000        // 50Hz, above that packets alias
+
+#define WAVE_OFF             0
+#define WAVE_SINE            1
+#define WAVE_TRIANGLE        2
+#define WAVE_SAW             3
+#define WAVE_SQUARE          4
+#define WAVE_SHAPES          5
+
+typedef struct {
+    uint32 stamp;                     // timebase_us() of the packet tick
+    uint8  channel;
+    uint8  level;                     // 1 for the high half of the wave
+} wavegen_edge;
+
+extern uint32 wavegen_edges_lost;
+
+void  wavegen_reset(void);
+void  wavegen_set(uint8 ch, uint8 shape, int16 amplitude, int16 offset, uint16 freq_chz);
+uint8 wavegen_active(void);
+uint8 wavegen_apply(volatile int32 channels[]);
+uint8 wavegen_next_edge(wavegen_edge *e);
+
+#endif
@@ -0,0 +1,187 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "crsf.h"
+
+// Length counts type, payload and CRC
+#define MIN_LEN   2
+#define MAX_LEN   (CRSF_MAX_FRAME - 2)
+
+static const uint8 crc8_table[256] = {
+    0x00, 0xd5, 0x7f, 0xaa, 0xfe, 0x2b, 0x81, 0x54, 0x29, 0xfc, 0x56, 0x83, 0xd7, 0x02, 0xa8, 0x7d,
+    0x52, 0x87, 0x2d, 0xf8, 0xac, 0x79, 0xd3, 0x06, 0x7b, 0xae, 0x04, 0xd1, 0x85, 0x50, 0xfa, 0x2f,
+    0xa4, 0x71, 0xdb, 0x0e, 0x5a, 0x8f, 0x25, 0xf0, 0x8d, 0x58, 0xf2, 0x27, 0x73, 0xa6, 0x0c, 0xd9,
+    0xf6, 0x23, 0x89, 0x5c, 0x08, 0xdd, 0x77, 0xa2, 0xdf, 0x0a, 0xa0, 0x75, 0x21, 0xf4, 0x5e, 0x8b,
+    0x9d, 0x48, 0xe2, 0x37, 0x63, 0xb6, 0x1c, 0xc9, 0xb4, 0x61, 0xcb, 0x1e, 0x4a, 0x9f, 0x35, 0xe0,
+    0xcf, 0x1a, 0xb0, 0x65, 0x31, 0xe4, 0x4e, 0x9b, 0xe6, 0x33, 0x99, 0x4c, 0x18, 0xcd, 0x67, 0xb2,
+    0x39, 0xec, 0x46, 0x93, 0xc7, 0x12, 0xb8, 0x6d, 0x10, 0xc5, 0x6f, 0xba, 0xee, 0x3b, 0x91, 0x44,
+    0x6b, 0xbe, 0x14, 0xc1, 0x95, 0x40, 0xea, 0x3f, 0x42, 0x97, 0x3d, 0xe8, 0xbc, 0x69, 0xc3, 0x16,
+    0xef, 0x3a, 0x90, 0x45, 0x11, 0xc4, 0x6e, 0xbb, 0xc6, 0x13, 0xb9, 0x6c, 0x38, 0xed, 0x47, 0x92,
+    0xbd, 0x68, 0xc2, 0x17, 0x43, 0x96, 0x3c, 0xe9, 0x94, 0x41, 0xeb, 0x3e, 0x6a, 0xbf, 0x15, 0xc0,
+    0x4b, 0x9e, 0x34, 0xe1, 0xb5, 0x60, 0xca, 0x1f, 0x62, 0xb7, 0x1d, 0xc8, 0x9c, 0x49, 0xe3, 0x36,
+    0x19, 0xcc, 0x66, 0xb3, 0xe7, 0x32, 0x98, 0x4d, 0x30, 0xe5, 0x4f, 0x9a, 0xce, 0x1b, 0xb1, 0x64,
+    0x72, 0xa7, 0x0d, 0xd8, 0x8c, 0x59, 0xf3, 0x26, 0x5b, 0x8e, 0x24, 0xf1, 0xa5, 0x70, 0xda, 0x0f,
+    0x20, 0xf5, 0x5f, 0x8a, 0xde, 0x0b, 0xa1, 0x74, 0x09, 0xdc, 0x76, 0xa3, 0xf7, 0x22, 0x88, 0x5d,
+    0xd6, 0x03, 0xa9, 0x7c, 0x28, 0xfd, 0x57, 0x82, 0xff, 0x2a, 0x80, 0x55, 0x01, 0xd4, 0x7e, 0xab,
+    0x84, 0x51, 0xfb, 0x2e, 0x7a, 0xaf, 0x05, 0xd0, 0xad, 0x78, 0xd2, 0x07, 0x53, 0x86, 0x2c, 0xf9,
+};
+
+uint8 crsf_crc8(const uint8 buf[], uint8 len)
+{
+    uint8 crc = 0;
+
+    while (len--)
+        crc = crc8_table[crc ^ *buf++];
+    return crc;
+}
+
+void crsf_reset(crsf_parser *p)
+{
+    p->len = 0;
+    p->next = 0;
+}
+
+static uint8 is_address(uint8 b)
+{
+    return b == CRSF_ADDR_FC || b == CRSF_ADDR_RADIO || b == CRSF_ADDR_RX || b == CRSF_ADDR_TX;
+}
+
+// Drops the first n bytes of buf
+static void shift(crsf_parser *p, uint8 n)
+{
+    uint8 i;
+
+    for (i = n; i < p->len; i++)
+        p->buf[i - n] = p->buf[i];
+    p->len -= n;
+}
+
+// Parses buf from the start, for bytes already seen once: after a bad CRC,
+// where a corrupted length may have swallowed intact frames behind it, and
+// for bytes buffered behind a frame found that way.  Drops one byte at a
+// time up to an address with a good length, then either keeps the partial
+// frame with its running CRC or checks the complete one.
+static uint8 scan(crsf_parser *p)
+{
+    uint8 i, frame_len, crc_len;
+
+    for (;;) {
+        for (i = 0; i < p->len && !is_address(p->buf[i]); i++)
+            ;
+        shift(p, i);
+        p->crc = 0;
+        if (p->len < 2)
+            return 0;
+        if (p->buf[1] < MIN_LEN || p->buf[1] > MAX_LEN) {
+            p->bad_len += 1;
+            shift(p, 1);
+            continue;
+        }
+        frame_len = p->buf[1] + 2;
+        crc_len = p->len < frame_len ? p->len - 2 : frame_len - 3;
+        p->crc = crsf_crc8(&p->buf[2], crc_len);
+        if (p->len < frame_len)
+            return 0;
+        if (p->crc == p->buf[frame_len - 1]) {
+            if (p->len > frame_len)
+                p->next = frame_len;
+            else
+                p->len = 0;
+            return 1;
+        }
+        p->bad_crc += 1;
+        shift(p, 1);
+    }
+}
+
+// Returns 1 when b completes a frame with a good CRC, left in p->buf until
+// the next byte.  The CRC runs as bytes arrive, so the cost per byte is a
+// table lookup and a few compares.  A bad CRC drops only the address byte
+// and scans the rest again, so intact frames behind a corrupted length
+// byte are kept.
+uint8 crsf_byte(crsf_parser *p, uint8 b)
+{
+    uint8 frame_len;
+
+    if (p->next) {
+        shift(p, p->next);
+        p->next = 0;
+        p->buf[p->len++] = b;
+        return scan(p);
+    }
+    if (p->len == 0) {
+        if (is_address(b))
+            p->buf[p->len++] = b;
+        return 0;
+    }
+    if (p->len == 1) {
+        if (b < MIN_LEN || b > MAX_LEN) {
+            p->bad_len += 1;
+            p->len = 0;
+            if (is_address(b))
+                p->buf[p->len++] = b;
+            return 0;
+        }
+        p->buf[p->len++] = b;
+        p->crc = 0;
+        return 0;
+    }
+
+    frame_len = p->buf[1] + 2;
+    p->buf[p->len++] = b;
+    if (p->len < frame_len) {
+        p->crc = crc8_table[p->crc ^ b];
+        return 0;
+    }
+    if (p->crc != b) {
+        p->bad_crc += 1;
+        shift(p, 1);
+        return scan(p);
+    }
+    p->len = 0;
+    return 1;
+}
+
+// 16 channels of 11 bits, least significant bit first, as SBUS packs them
+void crsf_channels(const uint8 payload[], uint16 channels[])
+{
+    const uint8 *q = payload;
+    uint32 acc = 0;
+    uint8 bits = 0;
+    uint8 ch;
+
+    for (ch = 0; ch < CRSF_CHANNELS; ch++) {
+        while (bits < 11) {
+            acc |= (uint32)*q++ << bits;
+            bits += 8;
+        }
+        channels[ch] = acc & 0x7ff;
+        acc >>= 11;
+        bits -= 11;
+    }
+}
+
+void crsf_link_stats(const uint8 payload[], crsf_link *link)
+{
+    link->uplink_rssi1 = payload[0];
+    link->uplink_rssi2 = payload[1];
+    link->uplink_lq = payload[2];
+    link->uplink_snr = (int8)payload[3];
+    link->antenna = payload[4];
+    link->rf_mode = payload[5];
+    link->tx_power = payload[6];
+    link->downlink_rssi = payload[7];
+    link->downlink_lq = payload[8];
+    link->downlink_snr = (int8)payload[9];
+}
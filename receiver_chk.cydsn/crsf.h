@@ -0,0 +1,81 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _CRSF_H_
+#define _CRSF_H_
+
+// Crossfire/ExpressLRS serial frames: address, length, type, payload and a
+// CRC8 (polynomial 0xd5) over type and payload.  Frames come back to back
+// at up to 1kHz, so they are found by address, length and CRC rather than
+// by the gap between them.  No hardware dependencies, builds on a host
+// with -DEMULATOR (see host/crsf_bench.c).
+#ifdef EMULATOR
+#include <stdint.h>
+typedef uint8_t  uint8;
+typedef int8_t   int8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t  int32;
+#else
+#include <project.h>
+#endif
+
+#define CRSF_MAX_FRAME       64     // address and length byte included
+#define CRSF_CHANNELS        16
+#define CRSF_CENTER         992     // 172..1811 is 988..2012us, as SBUS
+
+#define CRSF_ADDR_FC       0xc8     // receiver to flight controller
+#define CRSF_ADDR_RADIO    0xea
+#define CRSF_ADDR_RX       0xec
+#define CRSF_ADDR_TX       0xee
+
+#define CRSF_TYPE_GPS      0x02
+#define CRSF_TYPE_BATTERY  0x08
+#define CRSF_TYPE_LINK     0x14
+#define CRSF_TYPE_CHANNELS 0x16
+#define CRSF_TYPE_ATTITUDE 0x1e
+#define CRSF_TYPE_MODE     0x21
+
+typedef struct {
+    uint8 uplink_rssi1;             // -dBm
+    uint8 uplink_rssi2;
+    uint8 uplink_lq;                // %
+    int8  uplink_snr;               // dB
+    uint8 antenna;
+    uint8 rf_mode;                  // packet rate index, protocol specific
+    uint8 tx_power;                 // index
+    uint8 downlink_rssi;
+    uint8 downlink_lq;
+    int8  downlink_snr;
+} crsf_link;
+
+typedef struct {
+    uint8 buf[CRSF_MAX_FRAME];
+    uint8 len;                      // bytes in buf
+    uint8 next;                     // nonzero: buf[next..len) follows the frame returned
+    uint8 crc;                      // running over type and payload
+    uint32 bad_crc;
+    uint32 bad_len;
+} crsf_parser;
+
+void  crsf_reset(crsf_parser *p);
+uint8 crsf_byte(crsf_parser *p, uint8 b);
+uint8 crsf_crc8(const uint8 buf[], uint8 len);
+void  crsf_channels(const uint8 payload[], uint16 channels[]);
+void  crsf_link_stats(const uint8 payload[], crsf_link *link);
+
+// Type and payload of the frame crsf_byte() just completed
+#define crsf_type(p)     ((p)->buf[2])
+#define crsf_payload(p)  (&(p)->buf[3])
+
+#endif
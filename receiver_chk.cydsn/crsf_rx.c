@@ -0,0 +1,127 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "crsf_rx.h"
+#include "serial_rx.h"
+#include "timebase.h"
+
+#define UART_ERRORS    (UART_in_INTR_RX_OVERFLOW | UART_in_INTR_RX_FRAME_ERROR)
+#define POLL_BYTES     4            // half the FIFO
+
+volatile crsf_rx_counters crsf_rx_count;
+
+static crsf_rx_frame queue[CRSF_RX_QUEUE];
+static volatile uint8 head;         // written by the timer interrupt
+static volatile uint8 tail;         // written by the main loop
+
+static crsf_parser parser;
+static crsf_link link;
+static uint32 frame_start;
+static uint16 poll_us;
+
+
+static void queue_frame(uint32 end)
+{
+    crsf_rx_frame *f;
+
+    if ((uint8)(head - tail) >= CRSF_RX_QUEUE) {
+        crsf_rx_count.dropped += 1;
+        return;
+    }
+    f = &queue[head & (CRSF_RX_QUEUE - 1)];
+    crsf_channels(crsf_payload(&parser), f->channels);
+    f->start = frame_start;
+    f->end = end;
+    head += 1;                      // publish after the copy
+    crsf_rx_count.frames += 1;
+}
+
+static void frame_done(uint32 now)
+{
+    switch (crsf_type(&parser)) {
+    case CRSF_TYPE_CHANNELS:
+        if (parser.buf[1] == 24)    // 22 bytes of channels
+            queue_frame(now);
+        break;
+    case CRSF_TYPE_LINK:
+        crsf_link_stats(crsf_payload(&parser), &link);
+        crsf_rx_count.link += 1;
+        break;
+    default:
+        crsf_rx_count.last_type = crsf_type(&parser);
+        crsf_rx_count.telemetry += 1;
+        break;
+    }
+}
+
+// Protocol timer callback, returns us to the next poll
+uint16 crsf_rx_callback(volatile int32 channels[])
+{
+    uint32 now = timebase_us();
+    uint32 status = UART_in_GetRxInterruptSource() & UART_ERRORS;
+
+    (void)channels;
+    if (status) {
+        UART_in_ClearRxInterruptSource(status);
+        crsf_rx_count.errors += 1;
+        crsf_reset(&parser);
+    }
+    while (UART_in_SpiUartGetRxBufferSize()) {
+        if (parser.len == 0)
+            frame_start = now;
+        if (crsf_byte(&parser, UART_in_UartGetByte()))
+            frame_done(now);
+    }
+    crsf_rx_count.bad_crc = parser.bad_crc;
+    crsf_rx_count.bad_len = parser.bad_len;
+    return poll_us;
+}
+
+// Sets up UART_in, then proto_start(NULL, crsf_rx_callback)
+void crsf_rx_start(uint32 baud)
+{
+    serial_rx_setting setting = {baud, SERIAL_8N1, 0, 0};
+
+    serial_rx_configure(&setting);
+    memset((void *)&crsf_rx_count, 0, sizeof(crsf_rx_count));
+    memset(&parser, 0, sizeof(parser));
+    memset(&link, 0, sizeof(link));
+    head = tail = 0;
+    poll_us = POLL_BYTES * 10 * 1000000 / baud;
+}
+
+// After the protocol timer is stopped, leaves UART_in for the SBUS modes
+void crsf_rx_stop(void)
+{
+    serial_rx_configure(&serial_rx_settings[0]);
+}
+
+// Main loop side of the frame queue, returns 0 when empty
+uint8 crsf_rx_get(crsf_rx_frame *f)
+{
+    if (tail == head)
+        return 0;
+    *f = queue[tail & (CRSF_RX_QUEUE - 1)];
+    tail += 1;
+    return 1;
+}
+
+void crsf_rx_get_link(crsf_link *l)
+{
+    uint8 intr = CyEnterCriticalSection();
+
+    *l = link;
+    CyExitCriticalSection(intr);
+}
@@ -0,0 +1,53 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _CRSF_RX_H_
+#define _CRSF_RX_H_
+
+#include <project.h>
+#include "crsf.h"
+
+// CRSF on UART_in, 8N1 idle high.  UART_in has no interrupt and at 420000
+// baud its 8-byte FIFO fills in 190us, too close to the 200us SysTick, so
+// crsf_rx_callback() runs on the protocol timer and drains it every four
+// byte times.  Channel frames are queued with the stamps of their first
+// and last byte; link statistics are kept and other types counted.
+
+#define CRSF_RX_QUEUE        8      // frames, power of two
+
+typedef struct {
+    uint16 channels[CRSF_CHANNELS];
+    uint32 start;                   // timebase_us() of the address byte
+    uint32 end;                     // and of the CRC
+} crsf_rx_frame;
+
+typedef struct {
+    uint32 frames;                  // channel frames queued
+    uint32 dropped;                 // channel frames lost to a full queue
+    uint32 link;                    // link statistics frames
+    uint32 telemetry;               // frames of any other type
+    uint32 bad_crc;
+    uint32 bad_len;
+    uint32 errors;                  // UART overflow or framing error
+    uint8  last_type;               // of the last other frame
+} crsf_rx_counters;
+
+extern volatile crsf_rx_counters crsf_rx_count;
+
+void   crsf_rx_start(uint32 baud);
+void   crsf_rx_stop(void);
+uint16 crsf_rx_callback(volatile int32 channels[]);
+uint8  crsf_rx_get(crsf_rx_frame *f);
+void   crsf_rx_get_link(crsf_link *link);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// CX-10 receiver through the XN297 emulation.  The payload carries no
+// checksum of its own, so packets are checked with the XN297 CRC; the
+// length that passes tells green (15 byte) from blue (19 byte) boards.
+// Blue board transmitters wait for the aircraft id before sending data.
+
+#include <project.h>
+#include <string.h>
+#include "nrf24l01.h"
+#include "protocols.h"
+#include "proto_rx.h"
+
+#define CX10_PACKET_SIZE     15
+#define CX10A_PACKET_SIZE    19
+#define RAW_SIZE             (CX10A_PACKET_SIZE + 2)  // payload and CRC
+#define CX10_PACKET_PERIOD 1316     // us
+#define CX10A_PACKET_PERIOD 6000
+#define REPLY_TIME          500     // us for TX settling and the reply on air
+
+#define RF_BIND_CHANNEL    0x02
+#define NUM_RF_CHANNELS       4
+
+enum {
+    CHANNEL1 = 0,   // Aileron
+    CHANNEL2,       // Elevator
+    CHANNEL3,       // Throttle
+    CHANNEL4,       // Rudder
+    CHANNEL5,       // Rate/Mode
+    CHANNEL6,       // Flip
+};
+
+static const uint8 rx_tx_addr[] = {0xcc, 0xcc, 0xcc, 0xcc, 0xcc};
+static const uint8 bind_channel = RF_BIND_CHANNEL;
+static const uint8 aircraft_id[] = {0x5a, 0x3c, 0xa5, 0xc3};
+
+static uint8 format;                // of the last packet read
+static uint8 txid[4];
+static uint8 rf_chans[NUM_RF_CHANNELS];
+
+static void rx_mode(void)
+{
+    XN297_Configure(BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_CRCO)
+                  | BV(NRF24L01_00_PWR_UP) | BV(NRF24L01_00_PRIM_RX));
+    CyDelayUs(130);
+}
+
+static void cx10_rx_init(void)
+{
+    NRF24L01_Initialize();
+    XN297_SetTXAddr(rx_tx_addr, 5);
+    XN297_SetRXAddr(rx_tx_addr, 5);
+    NRF24L01_WriteReg(NRF24L01_01_EN_AA, 0x00);      // No Auto Acknowledgement
+    NRF24L01_WriteReg(NRF24L01_02_EN_RXADDR, 0x01);  // Pipe 0 only
+    NRF24L01_WriteReg(NRF24L01_11_RX_PW_P0, RAW_SIZE);
+    NRF24L01_WriteReg(NRF24L01_1C_DYNPD, 0x00);
+    NRF24L01_WriteReg(NRF24L01_1D_FEATURE, 0x00);
+    NRF24L01_SetBitrate(NRF24L01_BR_1M);             // 1Mbps
+    NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
+    rx_mode();
+    memset(txid, 0, sizeof(txid));
+    proto_rx_set_hops(&bind_channel, 1, 1, CX10A_PACKET_PERIOD);
+}
+
+// Green packets are shorter than the FIFO width, so the CRC is tried at
+// both lengths
+static uint8 cx10_rx_read(uint8 packet[])
+{
+    NRF24L01_ReadPayload(packet, RAW_SIZE);
+    if (XN297_CheckCRC(packet, CX10A_PACKET_SIZE))
+        format = FORMAT_CX10_BLUE;
+    else if (XN297_CheckCRC(packet, CX10_PACKET_SIZE))
+        format = FORMAT_CX10_GREEN;
+    else
+        return 0;
+    XN297_DecodePayload(packet, format == FORMAT_CX10_BLUE ? CX10A_PACKET_SIZE : CX10_PACKET_SIZE);
+    return format == FORMAT_CX10_BLUE ? CX10A_PACKET_SIZE : CX10_PACKET_SIZE;
+}
+
+// Little endian servo time in us, 0 if outside 1000..2000
+static uint16 servo(const uint8 *p)
+{
+    uint16 us = p[0] | (p[1] << 8);
+    return us < 1000 || us > 2000 ? 0 : us;
+}
+
+static uint8 cx10_rx_decode(const uint8 packet[], uint8 len, volatile int32 channels[])
+{
+    uint8 o = len == CX10A_PACKET_SIZE ? 4 : 0;
+    uint16 aileron, elevator, throttle, rudder;
+    uint8 mode;
+
+    if (packet[0] == 0xAA)
+        return PROTO_RX_BIND;
+    if (packet[0] != 0x55 || memcmp(&packet[1], txid, sizeof(txid)))
+        return PROTO_RX_BAD;
+    if (o && memcmp(&packet[5], aircraft_id, sizeof(aircraft_id)))
+        return PROTO_RX_BAD;
+
+    aileron  = servo(&packet[5+o]);
+    elevator = servo(&packet[7+o]);
+    throttle = servo(&packet[9+o]);
+    rudder   = packet[11+o] | ((packet[12+o] & 0x0f) << 8);
+    if (!aileron || !elevator || !throttle || rudder < 1000 || rudder > 2000)
+        return PROTO_RX_BAD;
+
+    // elevator and rudder are sent reversed
+    channels[CHANNEL1] = ((int32)aileron - 1500) * 20;
+    channels[CHANNEL2] = (1500 - (int32)elevator) * 20;
+    channels[CHANNEL3] = ((int32)throttle - 1500) * 20;
+    channels[CHANNEL4] = (1500 - (int32)rudder) * 20;
+    mode = packet[13+o] & 0x03;
+    channels[CHANNEL5] = mode == 0 ? CHAN_MIN_VALUE : mode == 1 ? CHAN_MAX_VALUE / 4 : CHAN_MAX_VALUE;
+    channels[CHANNEL6] = packet[12+o] & 0x10 ? CHAN_MAX_VALUE : CHAN_MIN_VALUE;
+    return PROTO_RX_DATA;
+}
+
+// Blue board transmitters listen after each bind packet until the
+// aircraft answers with its id
+static void send_aircraft_id(const uint8 packet[])
+{
+    uint8 reply[CX10A_PACKET_SIZE];
+
+    memcpy(reply, packet, sizeof(reply));
+    memcpy(&reply[5], aircraft_id, sizeof(aircraft_id));
+    reply[9] = 1;
+    XN297_Configure(BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_CRCO) | BV(NRF24L01_00_PWR_UP));
+    NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
+    NRF24L01_FlushTx();
+    XN297_WritePayload(reply, sizeof(reply));
+    CyDelayUs(REPLY_TIME);
+    rx_mode();
+}
+
+static void cx10_rx_bind(const uint8 packet[])
+{
+    memcpy(txid, &packet[1], sizeof(txid));
+    rf_chans[0] = 0x03 + (txid[0] & 0x0F);
+    rf_chans[1] = 0x16 + (txid[0] >> 4);
+    rf_chans[2] = 0x2D + (txid[1] & 0x0F);
+    rf_chans[3] = 0x40 + (txid[1] >> 4);
+    if (format == FORMAT_CX10_BLUE) {
+        send_aircraft_id(packet);
+        proto_rx_set_hops(rf_chans, NUM_RF_CHANNELS, 1, CX10A_PACKET_PERIOD);
+    } else {
+        proto_rx_set_hops(rf_chans, NUM_RF_CHANNELS, 1, CX10_PACKET_PERIOD);
+    }
+}
+
+const proto_rx_desc cx10_rx_desc = {
+    .name = "CX10",
+    .init = cx10_rx_init,
+    .read = cx10_rx_read,
+    .decode = cx10_rx_decode,
+    .bind = cx10_rx_bind,
+};
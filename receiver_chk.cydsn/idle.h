@@ -0,0 +1,34 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _IDLE_H_
+#define _IDLE_H_
+
+#include <project.h>
+
+// Event driven idle for the polling loops.  Interrupts signal events and
+// loops sleep with WFI when none are pending.  Any enabled interrupt wakes
+// the CPU; the flags only stop a loop going to sleep on an event that
+// arrived while it was busy.
+
+#define EVENT_RX       0x01   // USB serial interrupt, usually a byte received
+#define EVENT_TIMER    0x02   // protocol timer callback ran
+#define EVENT_CAPTURE  0x04   // PPM/PWM edge captured
+#define EVENT_TICK     0x08   // periodic wake for peripherals without interrupts
+
+void idle_start(void);
+void idle_tick_start(uint32 us);
+void idle_signal(uint8 events);
+void idle_wait(void);
+
+#endif
@@ -15,7 +15,18 @@
 #include <project.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "nrf24l01.h"
 #include "protocols.h"
+#include "idle.h"
+#include "timebase.h"
+#include "proto_rx.h"
+#include "sbus.h"
+#include "sbus_rx.h"
+#include "sbus_stats.h"
+#include "sbus_tx.h"
+#include "serial_rx.h"
+#include "crsf_rx.h"
+#include "ticks.h"
 
 static uint8 led;
 
@@ -47,40 +58,70 @@ static uint16 (*proto_callback)(volatile int32[]) = NULL;
 CY_ISR(proto_timer_interrupt_service) {
   if (proto_callback) proto_timer_WritePeriod( proto_callback(Channels) );
   proto_timer_ClearInterrupt(proto_timer_INTR_MASK_TC);
+  idle_signal(EVENT_TIMER);
 }
 
+#define PPM_TIMER_HZ 3000000        // ppm_timer's C/T clock
+
 static uint32 max_width;
 static volatile int32 interrupting;
 static volatile uint32 ppm_sync;
+
+// Raw PPM captures.  The ISR only queues them and ppm_decode() assembles
+// frames from the main loop, which keeps the width conversion and sync
+// tracking out of interrupt context.  The timer still has one capture
+// register: an edge that comes before the ISR reads the previous one
+// overwrites it, ring or not.
+#define PPM_RING 64                 // captures, power of two, 8ms at 125us
+static volatile uint16 ppm_ring[PPM_RING];
+static volatile uint8 ppm_head;     // written by the ISR
+static volatile uint8 ppm_tail;     // written by the main loop
+static volatile uint32 ppm_overruns;
 CY_ISR(ppm_timer_interrupt_service) {
   ppm_timer_ClearInterrupt(ppm_timer_INTR_MASK_CC_MATCH);
-  interrupting = 1;
-  
+  if ((uint8)(ppm_head - ppm_tail) < PPM_RING) {
+    ppm_ring[ppm_head & (PPM_RING - 1)] = ppm_timer_ReadCapture();
+    ppm_head += 1;
+  } else {
+    ppm_overruns += 1;
+  }
+  idle_signal(EVENT_CAPTURE);
+}
+
+// Widths, sync and min/max for everything queued since the last call.  A
+// width lost to an overrun upsets one frame and the sync count recovers.
+static void ppm_decode(void) {
   static uint32 prev_capture, prev_num_channels, sync_count;
   static uint32 curr_channel;
-  uint32 curr_capture = ppm_timer_ReadCapture();
-  uint32 width = ((curr_capture - prev_capture - 12) % 0xffff) / 3;   // microseconds - divisor from C/T clock
-  prev_capture = curr_capture;
+  uint32 curr_capture, width;
 
-  if (width > max_width) max_width = width;
-  if (width > 4500) {
-    prev_num_channels = number_of_channels;
-    number_of_channels = curr_channel;
-    if (number_of_channels == prev_num_channels) {
-      if (sync_count < 50) sync_count++;
+  while (ppm_tail != ppm_head) {
+    curr_capture = ppm_ring[ppm_tail & (PPM_RING - 1)];
+    ppm_tail += 1;
+    interrupting = 1;
+    width = TICKS_TO_US(ticks_since(curr_capture - 12, prev_capture), PPM_TIMER_HZ);
+    prev_capture = curr_capture;
+
+    if (width > max_width) max_width = width;
+    if (width > 4500) {
+      prev_num_channels = number_of_channels;
+      number_of_channels = curr_channel;
+      if (number_of_channels == prev_num_channels) {
+        if (sync_count < 50) sync_count++;
+      } else {
+        sync_count = 0;
+      }
+      ppm_sync = sync_count >= 3;
+      curr_channel = 0;
     } else {
-      sync_count = 0;
+//      Channels[curr_channel++] = ((int)width - 1500) * 20;
+      if ((int)width < channel_info[curr_channel].minimum)
+        channel_info[curr_channel].minimum = (int)width;
+      if ((int)width > channel_info[curr_channel].maximum)
+        channel_info[curr_channel].maximum = (int)width;
+      Channels[curr_channel++] = (int)width;
+      curr_channel %= MAX_CHANS;
     }
-    ppm_sync = sync_count >= 3;
-    curr_channel = 0;
-  } else {
-//    Channels[curr_channel++] = ((int)width - 1500) * 20;
-    if ((int)width < channel_info[curr_channel].minimum)
-      channel_info[curr_channel].minimum = (int)width;
-    if ((int)width > channel_info[curr_channel].maximum)
-      channel_info[curr_channel].maximum = (int)width;
-    Channels[curr_channel++] = (int)width;
-    curr_channel %= MAX_CHANS;
   }
 }
 
@@ -88,7 +129,7 @@ CY_ISR(pwm_timer_interrupt_service) {
   static uint32 int_mode = ppm_timer_TRIG_RISING;  // start mode as set in main
   static uint32 prev_capture;
   uint32 curr_capture = ppm_timer_ReadCapture();
-  uint32 width = ((curr_capture - prev_capture) % 0xffff) / 3;   // microseconds - divisor from C/T clock
+  uint32 width = TICKS_TO_US(ticks_since(curr_capture, prev_capture), PPM_TIMER_HZ);
   prev_capture = curr_capture;
 
   if (int_mode == ppm_timer_TRIG_RISING) {
@@ -104,13 +145,14 @@ CY_ISR(pwm_timer_interrupt_service) {
   ppm_timer_ClearInterrupt(ppm_timer_INTR_MASK_CC_MATCH);
   interrupting = 1;
   ppm_sync = 1;
+  idle_signal(EVENT_CAPTURE);
 }
 
 
 
-void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32 channels[])) {
+// Starts the protocol callback on the timer interrupt
+void proto_start(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32 channels[])) {
   uint8 def_addr[] = {0x3b,0xb6,0x00,0x00,0xa2};
-  uint8 ch, loop=1;
   
   if (init)
     init(def_addr);
@@ -120,6 +162,12 @@ void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32
   proto_timer_int_ClearPending();
   proto_callback = callback;
   proto_timer_int_Enable();
+}
+
+void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32 channels[])) {
+  uint8 ch, loop=1;
+  
+  proto_start(init, callback);
   
   while(loop) {
     if (USB_serial_SpiUartGetRxBufferSize()) {
@@ -131,6 +179,9 @@ void proto_run(void (*init)(uint8 tx_addr[]), uint16 (*callback)(volatile int32
       case 'z':
         reset_channel_info();
       }
+    } else {
+      ppm_decode();
+      idle_wait();
     }
   }
 }
@@ -153,7 +204,8 @@ uint16 ppm_monitor(volatile int32 channels[])
       pc += chars_out;
       size -= chars_out;
     }
-    snprintf(pc, size, "   max_width %ld, channels %d\r\n", (int32)max_width, number_of_channels);
+    snprintf(pc, size, "   max_width %ld, channels %d, overruns %lu\r\n", (int32)max_width,
+             number_of_channels, ppm_overruns);
   }
   USB_serial_UartPutString(outbuf);   
   interrupting = 0;
@@ -190,115 +242,203 @@ uint16 ppm_jitter_monitor(volatile int32 channels[])
 
 #define SBUS_NORMAL 0
 #define SBUS_INVERT 1
-uint16 sbus_monitor(uint8 polarity) {
-  static char outbuf[256];
-  char *pc = outbuf;
-  int32 chars_out;
-  int size = sizeof outbuf;
+#define SBUS_AUTO   2
 
-  if (polarity)
-    Control1_Write(1);
+// Last decoded SBUS frame, kept apart from the interrupt-written Channels
+static sbus_frame sbus;
+
+// SBUS generator on P1.5 for loopback tests, runs on the protocol timer
+// until another mode takes it.  Channel 1 follows the trigger output so
+// the latency modes see each step.
+#define SBUS_GEN_STEP 5000
+static const struct {
+  uint16 period;
+  uint8 polarity;
+  const char *name;
+} sbus_gen_modes[] = {
+  {14000, SBUS_NORMAL, "normal 14ms"},
+  { 7000, SBUS_NORMAL, "normal 7ms"},
+  {14000, SBUS_INVERT, "inverted 14ms"},
+  { 7000, SBUS_INVERT, "inverted 7ms"},
+};
+#define SBUS_GEN_MODES (sizeof(sbus_gen_modes) / sizeof(sbus_gen_modes[0]))
+static uint8 sbus_gen_mode;   // mode + 1, 0 is off
+
+static uint16 sbus_gen_callback(volatile int32 channels[]) {
+  channels[0] = Pin_sigout_ReadDataReg() ? SBUS_GEN_STEP : -SBUS_GEN_STEP;
+  return sbus_tx_callback(channels);
+}
+
+static uint8 sbus_gen_on(void) {
+  return proto_callback == sbus_gen_callback;
+}
+
+// Off, then each mode in turn
+void sbus_gen_next(void) {
+  proto_timer_int_Disable();
+  if (!sbus_gen_on())
+    sbus_gen_mode = 0;
+  sbus_gen_mode = (sbus_gen_mode + 1) % (SBUS_GEN_MODES + 1);
+  if (!sbus_gen_mode) {
+    proto_callback = NULL;
+    Pin_testout_Write(0);
+    USB_serial_UartPutString("SBUS generator off\r\n");
+    return;
+  }
+  // a ramp across the channels, 17 on and 18 off
+  for (int i=0; i < SBUS_CHANNELS; i++)
+    Channels[i] = i * 1250 - 10000;
+  Channels[16] = 1;
+  Channels[17] = -1;
+  sbus_tx_init(sbus_gen_modes[sbus_gen_mode - 1].period,
+               sbus_gen_modes[sbus_gen_mode - 1].polarity == SBUS_INVERT);
+  proto_start(NULL, sbus_gen_callback);
+  USB_serial_UartPutString("SBUS generator on P1.5 - ");
+  USB_serial_UartPutString(sbus_gen_modes[sbus_gen_mode - 1].name);
+  USB_serial_UartPutString("\r\n");
+}
+
+// Polarity values are the Control1 settings, SBUS_AUTO detects it
+static void sbus_start(uint8 polarity) {
+  if (polarity == SBUS_AUTO) {
+    sbus_rx_start_auto();
+    return;
+  }
+  Control1_Write(polarity);
+  sbus_rx_start();
+}
+
+static void sbus_polarity_report(void) {
+  if (sbus_rx_pol.state == SBUS_RX_FIXED)
+    return;
+  USB_serial_UartPutString(sbus_rx_pol.polarity == SBUS_RX_IDLE_LOW ? " | normal" : " | inverted");
+  if (sbus_rx_pol.state == SBUS_RX_LOCKED)
+    printd(" locked in %lums", sbus_rx_pol.lock_us / 1000);
   else
-    Control1_Write(0);
+    USB_serial_UartPutString(" searching");
+  printd(" flips %lu", sbus_rx_pol.flips);
+}
+
+// Per-second line for soak tests: the window first, then run totals
+static void sbus_report(const sbus_stats *w, const sbus_stats *t,
+                        const sbus_rx_telemetry *telem) {
+  printd("%lu/s", w->frames);
+  printd(" interval %lu", w->intervals ? w->interval_sum / w->intervals : 0);
+  printd(" (%lu", w->intervals ? w->interval_min : 0);
+  printd("-%lu)us", w->interval_max);
+  printd(" jitter %lu", w->jitters ? w->jitter_sum / w->jitters : 0);
+  printd("us lost %lu", w->lost);
+  printd(" fs %lu", w->failsafe);
+  printd(" | total %lu", t->frames);
+  printd(" lost %lu", t->frames ? t->lost * 100 / t->frames : 0);
+  printd(".%lu%%", t->frames ? t->lost * 1000 / t->frames % 10 : 0);
+  printd(" fs %lu", t->failsafe);
+  printd("/%lu entries", t->failsafe_entries);
+  printd(" interval %lu", t->intervals ? t->interval_min : 0);
+  printd("-%luus", t->interval_max);
+  printd(" outage %lu", t->outages);
+  printd(" hdr %lu", sbus_rx_count.header_errors);
+  printd(" ftr %lu", sbus_rx_count.footer_errors);
+  printd(" resync %lu", sbus_rx_count.resyncs);
+  printd(" drop %lu", sbus_rx_count.dropped);
+  printd(" uart %lu", sbus_rx_count.errors);
+  if (telem->cycles) {
+    printd(" | sbus2 slots %08lx", telem->occupied);
+    printd(" mistimed %lu", telem->mistimed);
+    printd(" cut %lu", telem->cut);
+  }
+  sbus_polarity_report();
+  USB_serial_UartPutString("\r\n");
+}
+
+// SBUS2 slots heard, with their data and start after the end byte
+static void sbus_slots(const sbus_rx_telemetry *telem) {
+  if (!telem->cycles) {
+    USB_serial_UartPutString("no SBUS2 frames\r\n");
+    return;
+  }
+  for (int i=0; i < SBUS2_SLOTS; i++) {
+    if (!(telem->occupied & (1UL << i)))
+      continue;
+    printd("slot %2lu: ", i);
+    printd("%02lx", telem->data[i][0]);
+    printd("%02lx", telem->data[i][1]);
+    printd(" at %luus\r\n", telem->offset[i]);
+  }
+}
+
+// Prints a summary once a second; 'c' shows the last frame's channels, 't'
+// the SBUS2 telemetry slots and 'z' restarts the totals.  Spins on sbus_rx_poll() rather than sleeping
+// so the interval stamps are not rounded to the tick.
+uint16 sbus_monitor(uint8 polarity) {
+  static sbus_rx_frame frame;
+  static sbus_stats window, total;
+  static sbus_rx_telemetry telem;
+  uint32 next_report;
+
+  sbus_stats_clear(&window);
+  sbus_stats_clear(&total);
+  sbus_start(polarity);
+  next_report = timebase_us() + 1000000;
   
-  static uint8 inbuf[25];
-  static uint8 inbuf_idx = 0;
   uint32 c;
-  uint32 cprevious;  
-  uint8 frame_loss, failsafe, loop=1;
+  uint8 loop=1;
   while(loop) {
     if (USB_serial_SpiUartGetRxBufferSize()) {
       switch (c=USB_serial_UartGetChar()) {
+      case 'c':
+        for (int i=0; i < SBUS_CHANNELS + 2; i++)
+          printd("%4ld ", (int32)sbus.channels[i]);
+        printd("flags %02lx\r\n", sbus.flags);
+        break;
+      case 't':
+        sbus_rx_get_telemetry(&telem);
+        sbus_slots(&telem);
+        break;
+      case 'z':
+        sbus_stats_clear(&window);
+        sbus_stats_clear(&total);
+        sbus_start(polarity);
+        break;
       case 'q':
         loop = 0;
         continue;
       }
     }
     
-    while (UART_in_SpiUartGetRxBufferSize()) {
-      c = UART_in_UartGetByte();
-//USB_serial_UartPutChar(c);
-//USB_serial_UartPutChar(inbuf_idx);
-      switch (inbuf_idx) {
-      case 24:
-    		if (c == 0x00) {
-    			inbuf[inbuf_idx] = c;
-
-          uint8 byte_in_sbus = 1;
-    			uint8 bit_in_sbus = 0;
-    			uint8 ch = 0;
-    			uint8 bit_in_channel = 0;
-          memset((void *)Channels, 0, sizeof Channels);
-          
-    			// channel data is interleaved and bit-reversed
-          for (int i=0; i < 176; i++) {
-    				if (inbuf[byte_in_sbus] & (1<<bit_in_sbus)) {
-    						Channels[ch] |= (1<<bit_in_channel);
-    				}
-    				bit_in_sbus = (bit_in_sbus + 1) % 8;
-            if (bit_in_sbus == 0) byte_in_sbus++;
-    				bit_in_channel = (bit_in_channel + 1) % 11;
-            if (bit_in_channel == 0) ch++;            
-    			}
-          Channels[16] = (inbuf[23] & 1) ? 2000 : 1000;
-          Channels[17] = (inbuf[23] & 2) ? 2000 : 1000;
-    			frame_loss   = (inbuf[23] & 4) ? 1 : 0;
-    			failsafe     = (inbuf[23] & 8) ? 1 : 0;
-          
-          for (int i=0; i < MAX_CHANS; i++) {
-            chars_out = snprintf(pc, size, "%4ld ", (int32)Channels[i]);
-            pc += chars_out;
-            size -= chars_out;
-          }
-          chars_out = snprintf(pc, size, "fl %d, fs %d\n\r", frame_loss, failsafe);
-          Pin_sigout_Write(1);
-          USB_serial_UartPutString(outbuf);
-          while (USB_serial_SpiUartGetTxBufferSize()) CyDelayUs(10);
-          Pin_sigout_Write(0);
-        }
-        inbuf_idx = 0;
-        pc = outbuf;
-        size = sizeof outbuf;
-        UART_in_SpiUartClearRxBuffer();
-        break;
-              
-      case 0:
-        if (c != 0x0f || cprevious != 0) {
-          cprevious = c;
-          break;
-        }
-        // intentional fall-through
-      default:
-        inbuf[inbuf_idx++] = c;
-      }
+    sbus_rx_poll();
+    while (sbus_rx_get(&frame)) {
+      sbus_decode(frame.data, &sbus);
+      sbus_stats_add(&window, sbus.flags, frame.start);
     }
 
+    if ((int32)(timebase_us() - next_report) >= 0) {
+      next_report += 1000000;
+      sbus_stats_merge(&total, &window);
+      sbus_rx_get_telemetry(&telem);
+      Pin_sigout_Write(1);
+      sbus_report(&window, &total, &telem);
+      Pin_sigout_Write(0);
+      sbus_stats_next(&window);
+    }
   }
+  sbus_rx_stop();
   return 6000;
 }
 
+// Time from the trigger edge to the end of the first frame showing it, in us
 uint16 sbus_latency(uint8 polarity) {
-  uint32 sbus_clock;  
+  uint32 sbus_clock = 0;
   static char outbuf[256];
+  static sbus_rx_frame frame;
   int triggered = -1, trigger_out = 0, trigger_count = 1;
   uint32 elapsed, min_elapsed=UINT_MAX, max_elapsed=0;
 
   
-  if (polarity)
-    Control1_Write(1);
-  else
-    Control1_Write(0);
   Pin_sigout_Write(trigger_out);
+  sbus_start(polarity);
   
-#if 0
-  char *pc = outbuf;
-  int32 chars_out;
-  int size = sizeof outbuf;  
-#endif
-  static uint8 inbuf[25];
-  static uint8 inbuf_idx = 0;
   uint32 c;
-  uint32 cprevious;
   uint8 loop=1;
   while(loop) {
     if (USB_serial_SpiUartGetRxBufferSize()) {
@@ -323,99 +463,519 @@ uint16 sbus_latency(uint8 polarity) {
       triggered = 1;
       trigger_out ^= 1;
       Pin_sigout_Write(trigger_out);
-      Pin_testout_Write(0);
-      sbus_clock = FreeRun_ReadCounter();
+      if (!sbus_gen_on())
+        Pin_testout_Write(0);
+      sbus_clock = timebase_us();
     } else if (triggered < 0) {
       triggered += 1;
     }
     
-    while (UART_in_SpiUartGetRxBufferSize()) {
-      c = UART_in_UartGetByte();
-//USB_serial_UartPutChar(c);
-//USB_serial_UartPutChar(inbuf_idx);
-      switch (inbuf_idx) {
-      case 24:
-#if 0        
-inbuf[inbuf_idx] = c;
-for (int i=0; i < 25; i++) {
-  chars_out = snprintf(pc, size, "%02x ", inbuf[i]);
-  pc += chars_out;
-  size -= chars_out;
-}
-chars_out = snprintf(pc, size, "\n\r");
-USB_serial_UartPutString(outbuf);
-while (USB_serial_SpiUartGetTxBufferSize()) CyDelayUs(10);
-pc = outbuf;
-size = sizeof outbuf;
-#endif
-    		if (c == 0x00) {
-    			inbuf[inbuf_idx] = c;
-
-          uint8 byte_in_sbus = 1;
-    			uint8 bit_in_sbus = 0;
-    			uint8 ch = 0;
-    			uint8 bit_in_channel = 0;
-          memset((void *)Channels, 0, sizeof Channels);
-          
-    			// channel data is interleaved and bit-reversed
-          for (int i=0; i < 176; i++) {
-    				if (inbuf[byte_in_sbus] & (1<<bit_in_sbus)) {
-    						Channels[ch] |= (1<<bit_in_channel);
-    				}
-    				bit_in_sbus = (bit_in_sbus + 1) % 8;
-            if (bit_in_sbus == 0) byte_in_sbus++;
-    				bit_in_channel = (bit_in_channel + 1) % 11;
-            if (bit_in_channel == 0) ch++;            
-    			}
-          Channels[16] = (inbuf[23] & 1) ? 2000 : 1000;
-          Channels[17] = (inbuf[23] & 2) ? 2000 : 1000;
-//    			frame_loss   = (inbuf[23] & 4) ? 1 : 0;
-//    			failsafe     = (inbuf[23] & 8) ? 1 : 0;
-          
-          if (triggered > 0 && (trigger_out ? (Channels[0] > 992) : (Channels[0] < 992))) {
-            elapsed = sbus_clock - FreeRun_ReadCounter();
-            Pin_testout_Write(1);            
-            triggered = -trigger_count;
-//TODO            if (trigger_count++ > 5000) trigger_count = 1;
-            if (elapsed < min_elapsed) min_elapsed = elapsed;
-            if (elapsed > max_elapsed) max_elapsed = elapsed;
-
-            snprintf(outbuf, sizeof outbuf, "%d: %lu, %lu, %lu \n\r", -triggered, elapsed, min_elapsed, max_elapsed);            
-            USB_serial_UartPutString(outbuf);
-            while (USB_serial_SpiUartGetTxBufferSize()) CyDelayUs(10);
-            UART_in_SpiUartClearRxBuffer();
-          }
-        }
-        inbuf_idx = 0;
-        break;
-              
-      case 0:
-        if (c != 0x0f || cprevious != 0) {
-          cprevious = c;
-          break;
-        }
-        // intentional fall-through
-      default:
-        inbuf[inbuf_idx++] = c;
+    // stamp bytes as they arrive rather than on the next tick
+    if (triggered > 0)
+      sbus_rx_poll();
+    while (sbus_rx_get(&frame)) {
+      sbus_decode(frame.data, &sbus);
+//      frame_loss   = (sbus.flags & SBUS_FLAG_LOST) ? 1 : 0;
+//      failsafe     = (sbus.flags & SBUS_FLAG_FAILSAFE) ? 1 : 0;
+      
+      if (triggered > 0 && (int32)(frame.end - sbus_clock) >= 0
+          && (trigger_out ? (sbus.channels[0] > SBUS_CENTER) : (sbus.channels[0] < SBUS_CENTER))) {
+        elapsed = frame.end - sbus_clock;
+        if (!sbus_gen_on())
+          Pin_testout_Write(1);
+        triggered = -trigger_count;
+//TODO        if (trigger_count++ > 5000) trigger_count = 1;
+        if (elapsed < min_elapsed) min_elapsed = elapsed;
+        if (elapsed > max_elapsed) max_elapsed = elapsed;
+
+        snprintf(outbuf, sizeof outbuf, "%d: %luus, %lu, %lu \n\r", -triggered, elapsed, min_elapsed, max_elapsed);            
+        USB_serial_UartPutString(outbuf);
+        while (USB_serial_SpiUartGetTxBufferSize()) CyDelayUs(10);
       }
     }
 
+    // keep polling while a trigger is outstanding so the measured time
+    // is not quantised by the wake tick
+    if (triggered < 0 && !USB_serial_SpiUartGetRxBufferSize())
+      idle_wait();
   }
+  sbus_rx_stop();
   return 6000;
 }
 
+// RF to SBUS latency on one board: the protocol engine sends a step on
+// aileron, the receiver under test is bound to it and its SBUS output is
+// read back on UART_in.  Latency runs from the payload write of the first
+// packet carrying the step to the end of the first SBUS frame showing it.
+#define AILERON          0
+#define THROTTLE         2
+#define RF_STEP       8000
+#define RF_SAMPLES     128      // steps kept for percentiles
+#define RF_TIMEOUT  500000      // us without the step showing up
+
+static volatile int32 rf_channels[PROTO_NUM_CHANNELS];
+static volatile uint8 rf_step;           // 1 requested, 2 in the packet, 3 sent
+static volatile uint32 rf_step_stamp;
+static volatile uint32 rf_step_packets;
+static const proto_desc *rf_desc = &symax_desc;
+
+static struct {
+  uint32 count;
+  uint32 lost;
+  uint32 total;
+  uint32 min;
+  uint32 max;
+  uint16 sample[RF_SAMPLES];    // us, saturated
+} rf_stats;
+
+static uint16 rf_latency_callback(volatile int32 channels[]) {
+  uint32 packets = proto_active.packets;
+  uint16 period;
+
+  (void)channels;
+  if (rf_step == 1) {
+    rf_channels[AILERON] = -rf_channels[AILERON];
+    rf_step = 2;
+  }
+  period = proto_engine_callback(rf_channels);
+  if (rf_step == 2 && proto_active.packets != packets) {
+    rf_step_stamp = timebase_us();
+    rf_step_packets = proto_active.packets;
+    Pin_sigout_Write(rf_channels[AILERON] > 0);
+    rf_step = 3;
+  }
+  return period;
+}
+
+static void rf_latency_init(uint8 tx_addr[]) {
+  memset((void *)rf_channels, 0, sizeof rf_channels);
+  rf_channels[THROTTLE] = CHAN_MIN_VALUE;
+  rf_channels[AILERON] = -RF_STEP;
+  rf_step = 0;
+  proto_engine_select(rf_desc, 0);
+  proto_engine_init(tx_addr);
+}
+
+static void rf_stats_reset(void) {
+  rf_stats.count = 0;
+  rf_stats.lost = 0;
+  rf_stats.total = 0;
+  rf_stats.min = UINT_MAX;
+  rf_stats.max = 0;
+}
+
+static void rf_stats_add(uint32 latency) {
+  if (rf_stats.count < RF_SAMPLES)
+    rf_stats.sample[rf_stats.count] = latency > 0xffff ? 0xffff : latency;
+  if (latency < rf_stats.min) rf_stats.min = latency;
+  if (latency > rf_stats.max) rf_stats.max = latency;
+  rf_stats.total += latency;
+  rf_stats.count += 1;
+}
+
+// Sorts the kept samples in place, their order carries no information
+static uint32 rf_percentile(uint8 num, uint8 percent) {
+  uint16 v;
+  uint8 i, j;
+
+  for (i = 1; i < num; i++) {
+    v = rf_stats.sample[i];
+    for (j = i; j > 0 && rf_stats.sample[j - 1] > v; j--)
+      rf_stats.sample[j] = rf_stats.sample[j - 1];
+    rf_stats.sample[j] = v;
+  }
+  return rf_stats.sample[(num - 1) * percent / 100];
+}
+
+static void rf_stats_report(void) {
+  uint8 num = rf_stats.count < RF_SAMPLES ? rf_stats.count : RF_SAMPLES;
+
+  printd("steps %lu", rf_stats.count);
+  printd(" lost %lu", rf_stats.lost);
+  if (rf_stats.count) {
+    printd(" min %luus", rf_stats.min);
+    printd(" p50 %luus", rf_percentile(num, 50));
+    printd(" p90 %luus", rf_percentile(num, 90));
+    printd(" p99 %luus", rf_percentile(num, 99));
+    printd(" max %luus", rf_stats.max);
+    printd(" mean %luus", rf_stats.total / rf_stats.count);
+    if (rf_stats.count > RF_SAMPLES)
+      printd(" (percentiles of first %lu)", RF_SAMPLES);
+  }
+  USB_serial_UartPutString("\r\n");
+}
+
+void rf_latency(uint8 polarity) {
+  static sbus_rx_frame frame;
+  uint8 loop = 1, settle = 0, settle_frames = 5, watch = 0, reverse = 0, high;
+  uint32 now;
+
+  rf_stats_reset();
+  Pin_sigout_Write(0);
+  sbus_start(polarity);
+  proto_start(rf_latency_init, rf_latency_callback);
+
+  while (loop) {
+    if (USB_serial_SpiUartGetRxBufferSize()) {
+      switch (USB_serial_UartGetChar()) {
+      case 'c':
+        watch = (watch + 1) % 16;
+        printd("watching SBUS channel %lu\r\n", watch + 1);
+        break;
+      case 'v':
+        reverse ^= 1;
+        USB_serial_UartPutString(reverse ? "receiver output reversed\r\n" : "receiver output normal\r\n");
+        break;
+      case '+':
+        settle_frames++;
+        break;
+      case '-':
+        if (settle_frames > 1) settle_frames--;
+        break;
+      case 's':
+        rf_stats_report();
+        break;
+      case 'r':
+        rf_stats_reset();
+        break;
+      case 'q':
+        loop = 0;
+        continue;
+      }
+    }
+
+    now = timebase_us();
+    if (rf_step == 3 && now - rf_step_stamp > RF_TIMEOUT) {
+      // not seen, wait for the output to settle on the new level again
+      rf_stats.lost += 1;
+      rf_step = 0;
+      settle = 0;
+      USB_serial_UartPutString("step not seen - bound? c for channel, v to reverse\r\n");
+    }
+
+    if (rf_step == 3)
+      sbus_rx_poll();
+    while (sbus_rx_get(&frame)) {
+      sbus_decode(frame.data, &sbus);
+      high = (sbus.channels[watch] > SBUS_CENTER) ^ reverse;
+      if (high != (rf_channels[AILERON] > 0) || (sbus.flags & (SBUS_FLAG_LOST | SBUS_FLAG_FAILSAFE))) {
+        settle = 0;      // step still in flight, lost frame or failsafe
+        continue;
+      }
+      if (rf_step == 3) {
+        rf_step = 0;
+        Pin_testout_Write(1);
+        rf_stats_add(frame.end - rf_step_stamp);
+        printd("%lu: ", rf_stats.count);
+        printd("%luus", frame.end - rf_step_stamp);
+        printd(" after %lu packets\r\n", proto_active.packets - rf_step_packets + 1);
+        if ((rf_stats.count & 15) == 0)
+          rf_stats_report();
+      } else if (rf_step == 0 && ++settle >= settle_frames) {
+        settle = 0;
+        Pin_testout_Write(0);
+        rf_step = 1;
+      }
+    }
+
+    // poll without sleeping while a step is outstanding so the measured
+    // time is not quantised by the wake tick
+    if (rf_step == 0 && !USB_serial_SpiUartGetRxBufferSize())
+      idle_wait();
+  }
+  proto_timer_int_Disable();
+  sbus_rx_stop();
+  rf_stats_report();
+}
+
+
+// nRF24 receiver: this board binds to a transmitter and decodes its packets
+static const proto_rx_desc * const rx_protocols[] = {
+  &symax_rx_desc, &yd717_rx_desc, &cx10_rx_desc,
+};
+static uint8 rx_protocol;
+
+static void rx_report(uint32 *last_packets) {
+  uint32 packets = proto_rx_stat.packets;
+  uint32 expected = proto_rx_stat.expected;
+  uint8 i;
+
+  if (!proto_rx_bound()) {
+    USB_serial_UartPutString("waiting for bind\r\n");
+    return;
+  }
+  USB_serial_UartPutString(proto_rx_synced() ? "sync   " : "search ");
+  for (i = 0; i < PROTO_RX_CHANNELS; i++)
+    printd("%6ld ", Channels[i]);
+  printd(" %lu/s", packets - *last_packets);
+  *last_packets = packets;
+  printd(" loss %lu", expected ? proto_rx_stat.missed * 100 / expected : 0);
+  printd(".%lu%%", expected ? proto_rx_stat.missed * 1000 / expected % 10 : 0);
+  printd(" bad %lu", proto_rx_stat.bad);
+  printd(" bind %lu", proto_rx_stat.bind);
+  printd(" sync %lu", proto_rx_stat.syncs);
+  printd("/%lu lost", proto_rx_stat.losses);
+  printd(" realign %lu", proto_rx_stat.realigns);
+  printd(" window %ld", proto_rx_stat.early);
+  printd("/+%ldus", proto_rx_stat.late);
+  for (i = 0; i < proto_rx_num_hops(); i++) {
+    printd(" %02lx:", proto_rx_hop_channel(i));
+    printd("%lu", proto_rx_stat.hits[i]);
+  }
+  USB_serial_UartPutString("\r\n");
+}
+
+void rx_run(void) {
+  const proto_rx_desc *desc = rx_protocols[rx_protocol];
+  uint32 next_report, last_packets = 0;
+  uint8 loop = 1, i;
+
+  if (!NRF24L01_Reset()) {
+    USB_serial_UartPutString("nRF24L01 not found!\r\n");
+    return;
+  }
+  for (i = 0; i < MAX_CHANS; i++)
+    Channels[i] = 0;
+  proto_rx_start(desc);
+  proto_start(NULL, proto_rx_callback);
+  next_report = timebase_us() + 1000000;
+
+  while (loop) {
+    if (USB_serial_SpiUartGetRxBufferSize()) {
+      switch (USB_serial_UartGetChar()) {
+      case 'z':
+        proto_rx_clear_stats();
+        last_packets = 0;
+        break;
+      case 'b':
+        proto_timer_int_Disable();
+        proto_rx_start(desc);
+        last_packets = 0;
+        proto_timer_int_Enable();
+        USB_serial_UartPutString("listening for bind\r\n");
+        break;
+      case 'q':
+        loop = 0;
+        continue;
+      }
+    }
+    if ((int32)(timebase_us() - next_report) >= 0) {
+      next_report += 1000000;
+      rx_report(&last_packets);
+    }
+    idle_wait();
+  }
+  proto_timer_int_Disable();
+  NRF24L01_SetTxRxMode(TXRX_OFF);
+}
+
+// Serial receiver of any supported protocol: finds the baud rate, format
+// and polarity, then prints channels and rates every second
+static void serial_setting(void) {
+  const serial_rx_setting *s = &serial_rx_settings[serial_rx_state.setting];
+
+  printd("%lu ", s->baud);
+  USB_serial_UartPutString(s->format == SERIAL_8E2 ? "8E2 " : "8N1 ");
+  USB_serial_UartPutString(s->inverted ? "inverted" : "plain");
+}
+
+void serial_run(void) {
+  static serial_rx_frame frame;
+  uint32 next_report, last_frames = 0;
+  uint8 loop = 1, proto = SERIAL_RX_NONE;
+
+  serial_rx_start();
+  next_report = timebase_us() + 1000000;
+
+  while (loop) {
+    if (USB_serial_SpiUartGetRxBufferSize()) {
+      switch (USB_serial_UartGetChar()) {
+      case 'z':
+        serial_rx_start();
+        last_frames = 0;
+        break;
+      case 'q':
+        loop = 0;
+        continue;
+      }
+    }
+    while (serial_rx_get(&frame))
+      ;
+    if (serial_rx_state.proto != proto) {
+      proto = serial_rx_state.proto;
+      if (proto == SERIAL_RX_NONE) {
+        USB_serial_UartPutString("lost, searching\r\n");
+      } else {
+        USB_serial_UartPutString(serial_protos[proto].name);
+        USB_serial_UartPutString(" at ");
+        serial_setting();
+        printd(", found in %lums\r\n", serial_rx_state.lock_us / 1000);
+      }
+    }
+    if ((int32)(timebase_us() - next_report) >= 0) {
+      next_report += 1000000;
+      if (proto == SERIAL_RX_NONE) {
+        USB_serial_UartPutString("searching ");
+        serial_setting();
+        USB_serial_UartPutString("\r\n");
+      } else {
+        USB_serial_UartPutString(serial_protos[proto].name);
+        for (int i=0; i < frame.frame.num_channels; i++)
+          printd(" %4lu", frame.frame.channels[i]);
+        printd("  %lu/s", serial_rx_state.frames - last_frames);
+        last_frames = serial_rx_state.frames;
+        printd(" flags %02lx", frame.frame.flags);
+        printd(" invalid %lu", serial_rx_state.invalid);
+        printd(" uart %lu", serial_rx_state.errors);
+        printd(" drop %lu\r\n", serial_rx_state.dropped);
+      }
+    }
+    idle_wait();
+  }
+  serial_rx_stop();
+}
+
+// CRSF/ELRS receiver: channel frame rate, interval and jitter as the SBUS
+// monitor, link statistics, and with 't' the latency from a P1.4 step to
+// the end of the first channel frame showing it on channel 1
+#define CRSF_SETTLE 20              // channel frames between steps
+
+static struct {
+  uint32 count, total, min, max;
+} crsf_lat;
+
+static void crsf_report(const sbus_stats *w, const crsf_link *link) {
+  printd("%lu/s", w->frames);
+  printd(" interval %lu", w->intervals ? w->interval_sum / w->intervals : 0);
+  printd(" (%lu", w->intervals ? w->interval_min : 0);
+  printd("-%lu)us", w->interval_max);
+  printd(" jitter %lu", w->jitters ? w->jitter_sum / w->jitters : 0);
+  printd("us rssi -%lu", link->uplink_rssi1);
+  printd("/-%lu", link->uplink_rssi2);
+  printd(" lq %lu", link->uplink_lq);
+  printd(" snr %ld", link->uplink_snr);
+  printd(" mode %lu", link->rf_mode);
+  printd(" power %lu", link->tx_power);
+  printd(" down -%lu", link->downlink_rssi);
+  printd("/%lu", link->downlink_lq);
+  printd(" | link %lu", crsf_rx_count.link);
+  printd(" telem %lu", crsf_rx_count.telemetry);
+  printd(" crc %lu", crsf_rx_count.bad_crc);
+  printd(" len %lu", crsf_rx_count.bad_len);
+  printd(" drop %lu", crsf_rx_count.dropped);
+  printd(" uart %lu", crsf_rx_count.errors);
+  if (crsf_lat.count) {
+    printd(" | latency %lu", crsf_lat.min);
+    printd("/%lu", crsf_lat.total / crsf_lat.count);
+    printd("/%luus", crsf_lat.max);
+  }
+  USB_serial_UartPutString("\r\n");
+}
+
+static void crsf_lat_clear(void) {
+  crsf_lat.count = 0;
+  crsf_lat.total = 0;
+  crsf_lat.min = UINT_MAX;
+  crsf_lat.max = 0;
+}
+
+void crsf_monitor(void) {
+  static crsf_rx_frame frame;
+  static sbus_stats window;
+  static crsf_link link;
+  uint32 baud = 420000, next_report, step_stamp = 0, elapsed;
+  uint8 loop = 1, latency = 0, step = 0, pending = 0, settle = 0;
+
+  sbus_stats_clear(&window);
+  crsf_lat_clear();
+  Pin_sigout_Write(step);
+  crsf_rx_start(baud);
+  proto_start(NULL, crsf_rx_callback);
+  next_report = timebase_us() + 1000000;
+
+  while (loop) {
+    if (USB_serial_SpiUartGetRxBufferSize()) {
+      switch (USB_serial_UartGetChar()) {
+      case 'b':
+        baud = baud == 420000 ? 921600 : 420000;
+        printd("%lu baud\r\n", baud);
+        proto_timer_int_Disable();
+        crsf_rx_start(baud);
+        proto_timer_int_Enable();
+        sbus_stats_clear(&window);
+        break;
+      case 'c':
+        for (int i=0; i < CRSF_CHANNELS; i++)
+          printd("%4lu ", frame.channels[i]);
+        USB_serial_UartPutString("\r\n");
+        break;
+      case 't':
+        latency ^= 1;
+        pending = 0;
+        settle = 0;
+        USB_serial_UartPutString(latency ? "latency on, P1.4 is trigger out\r\n" : "latency off\r\n");
+        break;
+      case 'z':
+        sbus_stats_clear(&window);
+        crsf_lat_clear();
+        break;
+      case 'q':
+        loop = 0;
+        continue;
+      }
+    }
+
+    while (crsf_rx_get(&frame)) {
+      sbus_stats_add(&window, 0, frame.start);
+      if (pending && (int32)(frame.end - step_stamp) >= 0
+          && (step ? frame.channels[0] > CRSF_CENTER : frame.channels[0] < CRSF_CENTER)) {
+        elapsed = frame.end - step_stamp;
+        crsf_lat.count += 1;
+        crsf_lat.total += elapsed;
+        if (elapsed < crsf_lat.min) crsf_lat.min = elapsed;
+        if (elapsed > crsf_lat.max) crsf_lat.max = elapsed;
+        pending = 0;
+        settle = 0;
+      } else if (latency && !pending && ++settle >= CRSF_SETTLE) {
+        step ^= 1;
+        Pin_sigout_Write(step);
+        step_stamp = timebase_us();
+        pending = 1;
+      }
+    }
+
+    if ((int32)(timebase_us() - next_report) >= 0) {
+      next_report += 1000000;
+      crsf_rx_get_link(&link);
+      crsf_report(&window, &link);
+      sbus_stats_next(&window);
+    }
+    idle_wait();
+  }
+  proto_timer_int_Disable();
+  crsf_rx_stop();
+}
+
 int main() {
   uint8 ch;
   
   CyGlobalIntEnable; /* enable global interrupts. */
 
   USB_serial_Start();
+  nRF_SPI_Start();
+  idle_start();
+  // UART_in has no interrupt; wake often enough that its 8-byte FIFO
+  // cannot fill at SBUS rate (about 110us per byte)
+  idle_tick_start(200);
+  timebase_start();
   proto_timer_int_StartEx(proto_timer_interrupt_service);
   proto_timer_Start();
   UART_in_Start();
   FreeRun_Start();
 
   for(;;) {
+    if (!USB_serial_SpiUartGetRxBufferSize())
+      idle_wait();
 
     /* Get received character or zero if nothing has been received yet */
     ch = USB_serial_UartGetChar(); 
@@ -432,6 +992,7 @@ int main() {
       ppm_timer_Stop();
       ppm_timer_SetCaptureMode(ppm_timer_TRIG_RISING);
       ppm_timer_int_StartEx(ppm_timer_interrupt_service);
+      ppm_tail = ppm_head;
       number_of_channels = 0;
       ppm_timer_Start();
       proto_run(NULL, ppm_monitor);
@@ -441,6 +1002,7 @@ int main() {
       ppm_timer_Stop();
       ppm_timer_SetCaptureMode(ppm_timer_TRIG_RISING);
       ppm_timer_int_StartEx(ppm_timer_interrupt_service);
+      ppm_tail = ppm_head;
       number_of_channels = 0;
       ppm_timer_Start();
       proto_run(NULL, ppm_jitter_monitor);
@@ -466,6 +1028,10 @@ int main() {
       USB_serial_UartPutString("SBUS monitor - inverted\r\n");
       sbus_monitor(SBUS_INVERT);
       break; 
+    case '0':
+      USB_serial_UartPutString("SBUS monitor - automatic polarity\r\n");
+      sbus_monitor(SBUS_AUTO);
+      break;
     case '6':
       USB_serial_UartPutString("SBUS latency - normal\r\n");
       sbus_latency(SBUS_NORMAL);
@@ -473,7 +1039,57 @@ int main() {
     case '7':
       USB_serial_UartPutString("SBUS latency - inverted\r\n");
       sbus_latency(SBUS_INVERT);
+      break;
+    case '8':
+      USB_serial_UartPutString("RF to SBUS latency - normal, ");
+      USB_serial_UartPutString(rf_desc->name);
+      USB_serial_UartPutString("\r\n");
+      rf_latency(SBUS_NORMAL);
+      break;
+    case '9':
+      USB_serial_UartPutString("RF to SBUS latency - inverted, ");
+      USB_serial_UartPutString(rf_desc->name);
+      USB_serial_UartPutString("\r\n");
+      rf_latency(SBUS_INVERT);
+      break;
+    case 'u':
+      USB_serial_UartPutString("SBUS latency - automatic polarity\r\n");
+      sbus_latency(SBUS_AUTO);
+      break;
+    case 'p':
+      rf_desc = rf_desc == &symax_desc ? &yd717_desc : &symax_desc;
+      USB_serial_UartPutString("RF latency protocol ");
+      USB_serial_UartPutString(rf_desc->name);
+      USB_serial_UartPutString("\r\n");
       break;       
+    case 'n':
+      USB_serial_UartPutString("nRF24 receiver - ");
+      USB_serial_UartPutString(rx_protocols[rx_protocol]->name);
+      USB_serial_UartPutString(", bind the transmitter now\r\n");
+      rx_run();
+      break;
+    case 'm':
+      rx_protocol = (rx_protocol + 1) % (sizeof(rx_protocols) / sizeof(rx_protocols[0]));
+      USB_serial_UartPutString("nRF24 receiver protocol ");
+      USB_serial_UartPutString(rx_protocols[rx_protocol]->name);
+      USB_serial_UartPutString("\r\n");
+      break;
+    case 'a':
+      USB_serial_UartPutString("Serial receiver - SBUS, IBUS, SUMD or Spektrum on P3.0, detected\r\n");
+      serial_run();
+      break;
+    case 'c':
+      USB_serial_UartPutString("CRSF receiver on P3.0\r\n");
+      crsf_monitor();
+      break;
+    case 'g':
+      sbus_gen_next();
+      break;
+    case 'f':
+      sbus_tx_flags = sbus_tx_flags == 0 ? SBUS_FLAG_LOST
+                    : sbus_tx_flags == SBUS_FLAG_LOST ? SBUS_FLAG_LOST | SBUS_FLAG_FAILSAFE : 0;
+      printd("SBUS generator flags %02lx\r\n", sbus_tx_flags);
+      break;
     case 'l':
       P1_6_Write(led ^= 1);
       break;
@@ -489,8 +1105,26 @@ int main() {
       USB_serial_UartPutString("3 - PWM monitor\r\n");      
       USB_serial_UartPutString("4 - SBUS monitor - normal polarity\r\n");      
       USB_serial_UartPutString("5 - SBUS monitor - inverted polarity\r\n");
+      USB_serial_UartPutString("0 - SBUS monitor - automatic polarity\r\n");
+      USB_serial_UartPutString("    link stats every second, while running: c - channels, t - SBUS2 slots, z - clear stats\r\n");
       USB_serial_UartPutString("6 - SBUS latency normal - P1.4 is trigger out\r\n");
       USB_serial_UartPutString("7 - SBUS latency inverted - P1.4 is trigger out\r\n");
+      USB_serial_UartPutString("u - SBUS latency automatic polarity\r\n");
+      USB_serial_UartPutString("8 - RF to SBUS latency normal - bind the receiver to this board\r\n");
+      USB_serial_UartPutString("9 - RF to SBUS latency inverted\r\n");
+      USB_serial_UartPutString("    while running: c - SBUS channel, v - reverse, +/- settle frames\r\n");
+      USB_serial_UartPutString("                   s - stats, r - clear stats\r\n");
+      USB_serial_UartPutString("p - RF latency protocol SymaX/YD717\r\n");
+      USB_serial_UartPutString("n - nRF24 receiver - channels and link stats every second\r\n");
+      USB_serial_UartPutString("    while running: b - bind again, z - clear stats\r\n");
+      USB_serial_UartPutString("m - nRF24 receiver protocol SymaX/YD717/CX10\r\n");
+      USB_serial_UartPutString("a - serial receiver - finds SBUS/IBUS/SUMD/Spektrum, baud and polarity\r\n");
+      USB_serial_UartPutString("    while running: z - search again\r\n");
+      USB_serial_UartPutString("c - CRSF/ELRS receiver - rates, link and latency every second\r\n");
+      USB_serial_UartPutString("    while running: b - 420000/921600 baud, c - channels, t - latency on P1.4, z - clear stats\r\n");
+      USB_serial_UartPutString("g - SBUS generator on P1.5 - off/normal/inverted at 14ms/7ms, loop back to P3.0\r\n");
+      USB_serial_UartPutString("    channel 1 follows P1.4 for the latency modes\r\n");
+      USB_serial_UartPutString("f - SBUS generator flags none/frame lost/failsafe\r\n");
       USB_serial_UartPutString("r - reset\r\n");
       USB_serial_UartPutString("l - led\r\n");
       USB_serial_UartPutString("b - enter bootloader\r\n");
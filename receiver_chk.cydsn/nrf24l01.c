@@ -135,6 +135,19 @@ uint8 NRF24L01_ReadPayload(uint8 *data, uint8 length)
   return res;
 }
 
+// Length of the payload at the head of the RX FIFO with dynamic payloads
+uint8 NRF24L01_GetDynamicPayloadSize()
+{
+  nRF_SPI_SpiUartClearRxBuffer();
+  outbuf[0] = R_RX_PL_WID;
+  nRF_SPI_SpiUartPutArray(outbuf, 2);
+  SPI_wait_done();
+  nRF_SPI_SpiUartReadRxData();
+  
+  SPI_wait_data();
+  return nRF_SPI_SpiUartReadRxData();
+}
+
 static uint8 Strobe(uint8 state)
 {
   nRF_SPI_SpiUartClearRxBuffer();
@@ -427,10 +440,31 @@ uint8 XN297_ReadPayload(uint8* msg, int len)
 {
     // TODO: if xn297_crc==1, check CRC before filling *msg 
     uint8 res = NRF24L01_ReadPayload(msg, len);
+    XN297_DecodePayload(msg, len);
+    return res;
+}
+
+// Descrambles a payload read with NRF24L01_ReadPayload
+void XN297_DecodePayload(uint8* msg, int len)
+{
     uint8 i;
     for(i=0; i<len; i++)
       msg[i] = bit_reverse(msg[i])^bit_reverse(xn297_scramble[i+xn297_addr_len]);
-    return res;
+}
+
+// Checks the two CRC bytes after len payload bytes of a raw read, before
+// XN297_DecodePayload.  The emulated CRC also covers the scrambled address.
+uint8 XN297_CheckCRC(const uint8* raw, int len)
+{
+    uint16 crc = initial;
+    int i;
+
+    for (i = 0; i < xn297_addr_len; ++i)
+        crc = crc16_update(crc, xn297_rx_addr[xn297_addr_len-i-1] ^ xn297_scramble[i]);
+    for (i = 0; i < len; ++i)
+        crc = crc16_update(crc, raw[i]);
+    crc ^= xn297_crc_xorout[xn297_addr_len - 3 + len];
+    return raw[len] == (crc >> 8) && raw[len+1] == (crc & 0xff);
 }
 
 
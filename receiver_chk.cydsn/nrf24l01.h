@@ -118,6 +118,7 @@ uint8 NRF24L01_ReadPayload(uint8 *data, uint8 len);
 
 uint8 NRF24L01_FlushTx();
 uint8 NRF24L01_FlushRx();
+uint8 NRF24L01_GetDynamicPayloadSize();
 uint8 NRF24L01_Activate(uint8 code);
 
 
@@ -137,5 +138,7 @@ void XN297_SetRXAddr(const uint8* addr, int len);
 void XN297_Configure(uint8 flags);
 uint8 XN297_WritePayload(uint8* msg, int len);
 uint8 XN297_ReadPayload(uint8* msg, int len);
+void XN297_DecodePayload(uint8* msg, int len);
+uint8 XN297_CheckCRC(const uint8* raw, int len);
 
 #endif
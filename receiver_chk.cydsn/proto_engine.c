@@ -0,0 +1,166 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "proto_engine.h"
+
+proto_instance proto_active;
+uint8 proto_engine_defer;
+void (*proto_engine_mix)(volatile int32 in[], int32 out[]);
+static const proto_desc *proto_selected;
+static uint8 proto_selected_format;
+
+
+static void snapshot(proto_instance *p, volatile int32 channels[])
+{
+    uint8 i;
+
+    if (proto_engine_mix) {
+        proto_engine_mix(channels, p->channels);
+    } else {
+        for (i = 0; i < PROTO_NUM_CHANNELS; i++)
+            p->channels[i] = channels[i];
+    }
+}
+
+void proto_engine_goto(proto_instance *p, uint8 phase)
+{
+    if (phase >= p->desc->num_phases) return;
+    p->phase = phase;
+    p->entered = 0;
+    p->count = 0;
+}
+
+void proto_engine_start(proto_instance *p, const proto_desc *desc, uint8 format, uint8 tx_addr[])
+{
+    memset(p, 0, sizeof(*p));
+    p->desc = desc;
+    p->format = format < desc->num_formats ? format : 0;
+    p->period = desc->period;
+    if (desc->init)
+        desc->init(p, tx_addr);
+    proto_engine_goto(p, 0);
+}
+
+uint16 proto_engine_run(proto_instance *p, volatile int32 channels[])
+{
+    const proto_phase *ph = &p->desc->phases[p->phase];
+    uint16 delay;
+    uint8 len, next, ready, entered, discarded;
+
+    if (ph->wait && (delay = ph->wait(p)) != 0)
+        return delay;
+
+    ready = p->deferred && p->prepared == p->ticks + 1 && p->ready_phase == p->phase;
+    p->ticks += 1;
+    discarded = p->discarded;
+    p->discarded = 0;
+
+    entered = p->entered;
+    if (!entered) {
+        p->entered = 1;
+        if (ph->enter) ph->enter(p);
+    }
+
+    if (ph->build) {
+        if (ready) {
+            len = p->ready_len;
+        } else {
+            if (p->deferred && entered && !ph->radio_build && !discarded)
+                p->late_builds += 1;
+            snapshot(p, channels);
+            len = ph->build(p);
+        }
+        if (len) {
+            p->desc->send(p, len);
+            p->packets += 1;
+        }
+    }
+
+    p->count += 1;
+    if (ph->repeat == 0 || p->count >= ph->repeat) {
+        next = ph->next ? ph->next(p) : ph->next_phase;
+        if (next != PROTO_STAY)
+            proto_engine_goto(p, next);
+    }
+
+    return ph->period ? ph->period : p->period;
+}
+
+// Builds the next packet in the main loop so the interrupt only has to
+// send it.  The first packet of a phase is built after enter has run, in
+// the interrupt.  A tick during the build discards the result.
+void proto_engine_prepare(proto_instance *p, volatile int32 channels[])
+{
+    uint32 gen = p->ticks;
+    uint8 phase = p->phase;
+    const proto_phase *ph = &p->desc->phases[phase];
+
+    if (!p->deferred || !p->entered || !ph->build || ph->radio_build
+        || p->prepared == gen + 1 || p->discarded)
+        return;
+
+    snapshot(p, channels);
+    p->ready_len = ph->build(p);
+    p->ready_phase = phase;
+    if (p->ticks == gen && !p->discarded)
+        p->prepared = gen + 1;
+}
+
+// Throws away a packet proto_engine_prepare() built or is building, so the
+// next tick builds from the channels as they are then.  For channel changes
+// made in the interrupt just before the tick that must go out in that
+// packet.
+void proto_engine_discard(proto_instance *p)
+{
+    if (!p->deferred)
+        return;
+    p->prepared = 0;
+    p->discarded = 1;
+}
+
+
+void proto_engine_select(const proto_desc *desc, uint8 format)
+{
+    proto_selected = desc;
+    proto_selected_format = format;
+}
+
+const char *proto_engine_format_name(const proto_instance *p)
+{
+    if (!p->desc) return "";
+    if (!p->desc->formats) return p->desc->name;
+    return p->desc->formats[p->format];
+}
+
+void proto_engine_init(uint8 tx_addr[])
+{
+    if (proto_selected) {
+        proto_engine_start(&proto_active, proto_selected, proto_selected_format, tx_addr);
+        proto_active.deferred = proto_engine_defer;
+    }
+}
+
+// Called from the main loop for work too slow for interrupt context
+void proto_engine_background(void)
+{
+    if (proto_active.desc && proto_active.desc->background)
+        proto_active.desc->background(&proto_active);
+}
+
+uint16 proto_engine_callback(volatile int32 channels[])
+{
+    if (!proto_active.desc)
+        return 1000;
+    return proto_engine_run(&proto_active, channels);
+}
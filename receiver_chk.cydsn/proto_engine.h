@@ -0,0 +1,106 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _PROTO_ENGINE_H_
+#define _PROTO_ENGINE_H_
+
+// The engine has no hardware dependencies so it also builds on a host
+// with -DEMULATOR against a simulated radio.
+#ifdef EMULATOR
+#include <stdint.h>
+#include <string.h>
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+#else
+#include <project.h>
+#endif
+
+#define PROTO_NUM_CHANNELS  8     // channels snapshotted for each packet
+#define PROTO_MAX_PACKET   32     // nRF24L01 maximum payload
+#define PROTO_STAY       0xff     // transition result: remain in current phase
+
+typedef struct proto_instance proto_instance;
+
+// One step of a protocol state machine.  Each timer tick the engine calls
+// wait (if any), then enter on the first tick of the phase, then build and
+// the protocol send routine.  After repeat packets (or every packet when
+// repeat is 0) the transition rule picks the next phase.
+typedef struct {
+    void   (*enter)(proto_instance *p);   // once on phase entry, may be NULL
+    uint16 (*wait)(proto_instance *p);    // nonzero: poll again after that many us
+    uint8  (*build)(proto_instance *p);   // fill p->packet, return length, 0 sends nothing
+    uint16 period;                        // us to next tick, 0 for protocol default
+    uint16 repeat;                        // ticks before transition, 0 for no limit
+    uint8  (*next)(proto_instance *p);    // transition rule, NULL to use next_phase
+    uint8  next_phase;
+    uint8  radio_build;                   // build talks to the radio, never deferred
+    uint8  listen;                        // receives between packets, proto_sched
+                                          // lets no other instance use the radio
+} proto_phase;
+
+typedef struct {
+    const char *name;
+    void (*init)(proto_instance *p, uint8 tx_addr[]);
+    void (*send)(proto_instance *p, uint8 len);
+    void (*background)(proto_instance *p);  // main loop work, may be NULL
+    void (*resume)(proto_instance *p);      // restore radio setup after another protocol used it
+    const proto_phase *phases;
+    uint8 num_phases;
+    uint16 period;                        // default packet period in us
+    const char * const *formats;          // variant names, NULL if only one
+    uint8 num_formats;
+} proto_desc;
+
+struct proto_instance {
+    const proto_desc *desc;
+    uint8  format;                        // index into desc->formats
+    uint8  phase;
+    uint8  entered;
+    uint16 count;                         // ticks completed in current phase
+    uint16 period;                        // default period, init may override
+    uint32 packets;                       // packets sent since start
+    uint8  deferred;                      // build in proto_engine_prepare when possible
+    volatile uint8  ready_len;
+    volatile uint8  ready_phase;          // phase the prepared packet was built for
+    volatile uint32 ticks;                // ticks that reached the build step
+    volatile uint32 prepared;             // ticks + 1 when packet holds the next packet
+    uint32 late_builds;                   // deferred build not ready, built in interrupt
+    volatile uint8  discarded;            // prepared packet thrown away, build inline
+    int32  channels[PROTO_NUM_CHANNELS];  // snapshot taken before each build
+    uint8  packet[PROTO_MAX_PACKET];
+};
+
+void   proto_engine_start(proto_instance *p, const proto_desc *desc, uint8 format, uint8 tx_addr[]);
+uint16 proto_engine_run(proto_instance *p, volatile int32 channels[]);
+void   proto_engine_goto(proto_instance *p, uint8 phase);
+void   proto_engine_prepare(proto_instance *p, volatile int32 channels[]);
+void   proto_engine_discard(proto_instance *p);
+
+// Optional stage between the input channels and the packet, for example
+// mixer_run.  NULL copies the channels unchanged.
+extern void (*proto_engine_mix)(volatile int32 in[], int32 out[]);
+
+// Single instance driven by proto_run() in main
+extern proto_instance proto_active;
+extern uint8 proto_engine_defer;          // proto_engine_init starts with deferred builds
+void   proto_engine_select(const proto_desc *desc, uint8 format);
+const char *proto_engine_format_name(const proto_instance *p);
+void   proto_engine_init(uint8 tx_addr[]);
+uint16 proto_engine_callback(volatile int32 channels[]);
+void   proto_engine_background(void);
+
+#endif
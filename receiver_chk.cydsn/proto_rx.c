@@ -0,0 +1,232 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "proto_rx.h"
+#include "nrf24l01.h"
+#include "timebase.h"
+
+#define POLL_SEARCH        100      // us between FIFO polls while parked
+#define POLL_SYNC           50      // and inside the sync window
+#define SYNC_WINDOW        300      // us either side of the predicted packet
+#define BIND_TIMEOUT   2000000      // us without data before listening for bind again
+#define REALIGN_VISITS       3      // lopsided channel visits before moving a slot
+
+enum {
+    RX_SEARCH = 0,                  // parked on one channel
+    RX_SYNC,                        // hopping with the transmitter
+};
+
+volatile proto_rx_stats proto_rx_stat;
+
+static const proto_rx_desc *rx;
+static uint8 hops[PROTO_RX_MAX_HOPS];
+static uint8 num_hops, per_hop;
+static uint16 period;
+
+static uint8 state, bound;
+static uint8 hop, slot;             // position in the hop sequence
+static uint8 visit;                 // bit per slot received on this channel visit
+static uint8 late_visits, early_visits;
+static uint16 misses;               // consecutive
+static uint32 expected;             // predicted arrival of the next packet
+static uint32 dwell_end;            // parked: time to try the next channel
+static uint32 last_data;
+static uint8 packet[PROTO_RX_MAX_PACKET];
+
+
+void proto_rx_set_hops(const uint8 chans[], uint8 num, uint8 hop_packets, uint16 packet_period)
+{
+    if (num > PROTO_RX_MAX_HOPS) num = PROTO_RX_MAX_HOPS;
+    memcpy(hops, chans, num);
+    num_hops = num;
+    per_hop = hop_packets;
+    period = packet_period;
+}
+
+// Packets received before a hop belong to the old channel
+static void tune(uint8 h)
+{
+    hop = h;
+    NRF24L01_WriteReg(NRF24L01_05_RF_CH, hops[hop]);
+    NRF24L01_FlushRx();
+    NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
+}
+
+// Parks for one whole transmitter cycle and a packet, so the transmitter
+// comes round to this channel whatever its position
+static void search(uint32 now, uint8 h)
+{
+    state = RX_SEARCH;
+    tune(h % num_hops);
+    dwell_end = now + (uint32)(num_hops * per_hop + 1) * period;
+}
+
+static void listen_bind(uint32 now)
+{
+    bound = 0;
+    rx->init();
+    last_data = now;
+    search(now, 0);
+}
+
+// Moves to the next packet slot.  A channel visit that only caught its
+// first packet means the transmitter hops a packet before us, one that only
+// caught its last means a packet after us.
+static void next_slot(void)
+{
+    if (++slot < per_hop)
+        return;
+    slot = 0;
+    if (per_hop > 1) {
+        if (visit == 1)
+            late_visits += 1;
+        else if (visit == 1 << (per_hop - 1))
+            early_visits += 1;
+        else if (visit)
+            late_visits = early_visits = 0;
+    }
+    visit = 0;
+
+    if (late_visits >= REALIGN_VISITS) {
+        late_visits = 0;
+        proto_rx_stat.realigns += 1;
+        slot = 1;
+    } else if (early_visits >= REALIGN_VISITS) {
+        early_visits = 0;
+        proto_rx_stat.realigns += 1;
+        slot = per_hop - 1;
+        return;                     // stay for this channel's last packet
+    }
+    tune((hop + 1) % num_hops);
+}
+
+static void received(uint32 now, uint8 result)
+{
+    int32 error;
+
+    if (result == PROTO_RX_BAD) {
+        proto_rx_stat.bad += 1;
+        return;
+    }
+    if (result == PROTO_RX_BIND) {
+        proto_rx_stat.bind += 1;
+        if (!bound) {
+            rx->bind(packet);
+            bound = 1;
+            last_data = now;
+            search(now, 0);
+        }
+        return;
+    }
+
+    proto_rx_stat.packets += 1;
+    proto_rx_stat.hits[hop] += 1;
+    last_data = now;
+    if (state == RX_SEARCH) {
+        // which slot this was is a guess, one lopsided visit corrects it
+        state = RX_SYNC;
+        proto_rx_stat.syncs += 1;
+        slot = 0;
+        visit = 0;
+        late_visits = REALIGN_VISITS - 1;
+        early_visits = 0;
+    } else {
+        error = now - expected;
+        proto_rx_stat.expected += 1;
+        if (error < proto_rx_stat.early) proto_rx_stat.early = error;
+        if (error > proto_rx_stat.late) proto_rx_stat.late = error;
+    }
+    visit |= 1 << slot;
+    misses = 0;
+    expected = now + period;
+    next_slot();
+}
+
+static void missed(uint32 now)
+{
+    proto_rx_stat.expected += 1;
+    proto_rx_stat.missed += 1;
+    expected += period;
+    next_slot();
+    if (++misses > 2 * num_hops * per_hop) {
+        proto_rx_stat.losses += 1;
+        search(now, hop);
+    }
+}
+
+void proto_rx_start(const proto_rx_desc *desc)
+{
+    rx = desc;
+    proto_rx_clear_stats();
+    listen_bind(timebase_us());
+}
+
+// Protocol timer callback, returns us to the next poll
+uint16 proto_rx_callback(volatile int32 channels[])
+{
+    uint32 now = timebase_us();
+    int32 wait;
+    uint8 len;
+
+    if (NRF24L01_ReadReg(NRF24L01_07_STATUS) & BV(NRF24L01_07_RX_DR)) {
+        len = rx->read(packet);
+        NRF24L01_FlushRx();
+        NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
+        received(now, len ? rx->decode(packet, len, channels) : PROTO_RX_BAD);
+    }
+
+    if (state == RX_SEARCH) {
+        if (bound && now - last_data > BIND_TIMEOUT)
+            listen_bind(now);
+        else if ((int32)(now - dwell_end) >= 0)
+            search(now, hop + 1);
+        return POLL_SEARCH;
+    }
+
+    if ((int32)(now - expected) > SYNC_WINDOW)
+        missed(now);
+    if (state != RX_SYNC)
+        return POLL_SEARCH;
+    wait = expected - SYNC_WINDOW - now;
+    return wait < POLL_SYNC ? POLL_SYNC : wait;
+}
+
+void proto_rx_clear_stats(void)
+{
+    uint8 intr = CyEnterCriticalSection();
+
+    memset((void *)&proto_rx_stat, 0, sizeof(proto_rx_stat));
+    CyExitCriticalSection(intr);
+}
+
+uint8 proto_rx_synced(void)
+{
+    return state == RX_SYNC;
+}
+
+uint8 proto_rx_bound(void)
+{
+    return bound;
+}
+
+uint8 proto_rx_num_hops(void)
+{
+    return num_hops;
+}
+
+uint8 proto_rx_hop_channel(uint8 h)
+{
+    return hops[h];
+}
@@ -0,0 +1,74 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _PROTO_RX_H_
+#define _PROTO_RX_H_
+
+#include <project.h>
+
+// Receiver side of the nRF24 protocols.  The engine runs from the protocol
+// timer interrupt: it listens for bind packets, then follows the transmitter
+// hop sequence.  Until the first data packet it parks on one channel long
+// enough for the transmitter to come round; after that it predicts each
+// packet from the protocol period, opens a short window around it and hops
+// with the transmitter whether or not the packet arrived.
+//
+// Decoded channels are -10000..10000 in AETR order, then the flags.
+
+#define PROTO_RX_MAX_HOPS     16
+#define PROTO_RX_MAX_PACKET   32
+#define PROTO_RX_CHANNELS      8
+
+// decode results
+#define PROTO_RX_BAD           0
+#define PROTO_RX_DATA          1
+#define PROTO_RX_BIND          2
+
+typedef struct {
+    const char *name;
+    void  (*init)(void);                  // radio to RX on the bind address, calls proto_rx_set_hops
+    uint8 (*read)(uint8 packet[]);        // payload from the RX FIFO, returns length, 0 if bad
+    uint8 (*decode)(const uint8 packet[], uint8 len, volatile int32 channels[]);
+    void  (*bind)(const uint8 packet[]);  // data address and hops from a bind packet
+} proto_rx_desc;
+
+typedef struct {
+    uint32 packets;                       // good data packets
+    uint32 bad;                           // failed checksum, length or id
+    uint32 bind;                          // bind packets
+    uint32 expected;                      // data packet slots passed while in sync
+    uint32 missed;                        // of those, nothing received
+    uint32 syncs;                         // sync gained
+    uint32 losses;                        // sync lost
+    uint32 realigns;                      // slot within a hop corrected
+    int32  early;                         // arrival before prediction, us (negative)
+    int32  late;                          // arrival after prediction, us
+    uint32 hits[PROTO_RX_MAX_HOPS];       // data packets per hop channel
+} proto_rx_stats;
+
+extern const proto_rx_desc symax_rx_desc;
+extern const proto_rx_desc yd717_rx_desc;
+extern const proto_rx_desc cx10_rx_desc;
+
+extern volatile proto_rx_stats proto_rx_stat;
+
+void   proto_rx_set_hops(const uint8 chans[], uint8 num, uint8 per_hop, uint16 period);
+void   proto_rx_start(const proto_rx_desc *desc);
+uint16 proto_rx_callback(volatile int32 channels[]);
+void   proto_rx_clear_stats(void);
+uint8  proto_rx_synced(void);
+uint8  proto_rx_bound(void);
+uint8  proto_rx_num_hops(void);
+uint8  proto_rx_hop_channel(uint8 hop);
+
+#endif
@@ -13,20 +13,30 @@
 */
 #ifndef _PROTOCOLS_H_
 #define _PROTOCOLS_H_
+
+#include "proto_engine.h"
   
 #define CHAN_MIN_VALUE -10000
 #define CHAN_MAX_VALUE  10000
   
-extern uint8 symax_phase;
-void symax_init(uint8 tx_addr[]);
-uint16 symax_callback(volatile int32 channels[]);
-void symax_send_packet(uint8 bind);
+// SymaX phases, exported so test modes can wait for the data phase
+enum {
+    SYMAX_INIT1 = 0,
+    SYMAX_BIND,
+    SYMAX_DATA
+};
+extern const proto_desc symax_desc;
 void symax_set_channels(uint8);
+const uint8 *symax_hop_channels(uint8 address);
 
-void yd717_init(uint8 tx_addr[]);
-uint16 yd717_callback(volatile int32 channels[]);
+extern const proto_desc yd717_desc;
 
-void cx10_init(uint8 tx_addr[]);
-uint16 cx10_callback(volatile int32 channels[]);
+enum {
+    FORMAT_CX10_GREEN = 0,
+    FORMAT_CX10_BLUE,
+    FORMAT_DM007,
+};
+extern const proto_desc cx10_desc;
+void cx10_forget_bind(void);
 
 #endif
@@ -0,0 +1,91 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sbus.h"
+
+// 16 11-bit channels and two digital channels from a 25 byte frame.
+// Channels are packed least significant bit first from frame[1], so bytes
+// are shifted into a 32-bit accumulator above the bits still unused and
+// each channel is the low 11 bits.
+void sbus_decode(const uint8 frame[], sbus_frame *out)
+{
+    const uint8 *p = &frame[1];
+    uint32 acc = 0;
+    uint8 bits = 0;
+    uint8 ch;
+
+    for (ch = 0; ch < SBUS_CHANNELS; ch++) {
+        acc |= (uint32)*p++ << bits;
+        bits += 8;
+        if (bits < 11) {
+            acc |= (uint32)*p++ << bits;
+            bits += 8;
+        }
+        out->channels[ch] = acc & 0x7ff;
+        acc >>= 11;
+        bits -= 11;
+    }
+    out->flags = frame[23];
+    out->channels[16] = (frame[23] & SBUS_FLAG_CH17) ? 2000 : 1000;
+    out->channels[17] = (frame[23] & SBUS_FLAG_CH18) ? 2000 : 1000;
+}
+
+// Inverse of sbus_decode: channels go into the accumulator above the bits
+// not yet written and whole bytes come off the bottom.  Channels 17 and 18
+// set their flag bits, above 1500 is on, so decoding the result gives the
+// same frame back.
+void sbus_encode(const sbus_frame *in, uint8 frame[])
+{
+    uint8 *p = &frame[1];
+    uint32 acc = 0;
+    uint8 bits = 0;
+    uint8 ch, flags;
+
+    frame[0] = 0x0f;
+    for (ch = 0; ch < SBUS_CHANNELS; ch++) {
+        acc |= (uint32)(in->channels[ch] & 0x7ff) << bits;
+        bits += 11;
+        while (bits >= 8) {
+            *p++ = acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    flags = in->flags & ~(SBUS_FLAG_CH17 | SBUS_FLAG_CH18);
+    if (in->channels[16] > 1500)
+        flags |= SBUS_FLAG_CH17;
+    if (in->channels[17] > 1500)
+        flags |= SBUS_FLAG_CH18;
+    frame[23] = flags;
+    frame[24] = 0x00;
+}
+
+// Slot ids are the slot number bit-reversed in the top five bits, over 011
+static uint8 reverse5(uint8 v)
+{
+    return ((v & 0x01) << 4) | ((v & 0x02) << 2) | (v & 0x04)
+         | ((v & 0x08) >> 2) | ((v & 0x10) >> 4);
+}
+
+uint8 sbus2_slot_id(uint8 slot)
+{
+    return (reverse5(slot) << 3) | 0x03;
+}
+
+uint8 sbus2_slot_of(uint8 id)
+{
+    if ((id & 0x07) != 0x03)
+        return 0xff;
+    return reverse5(id >> 3);
+}
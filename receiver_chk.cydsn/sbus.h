@@ -0,0 +1,59 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SBUS_H_
+#define _SBUS_H_
+
+// No hardware dependencies, so the decoder and encoder also build on a host with
+// -DEMULATOR (see host/sbus_bench.c).
+#ifdef EMULATOR
+#include <stdint.h>
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t  int32;
+#else
+#include <project.h>
+#endif
+
+#define SBUS_FRAME_LEN     25
+#define SBUS_CHANNELS      16       // proportional, 11 bits each
+#define SBUS_CENTER       992
+
+// frame[23] flag bits
+#define SBUS_FLAG_CH17   0x01
+#define SBUS_FLAG_CH18   0x02
+#define SBUS_FLAG_LOST   0x04
+#define SBUS_FLAG_FAILSAFE 0x08
+
+// frame[24] is 0x00 for SBUS.  SBUS2 sends 0x04, 0x14, 0x24 or 0x34 and
+// follows the frame with telemetry slots 0-7, 8-15, 16-23 or 24-31.  Each
+// slot is an id byte and two data bytes, slots start 660us apart.
+#define SBUS_END_OK(b)     ((b) == 0x00 || ((b) & 0xcf) == 0x04)
+#define SBUS2_END(b)       (((b) & 0xcf) == 0x04)
+#define SBUS2_GROUP(b)     ((b) >> 4)
+#define SBUS2_SLOTS        32
+#define SBUS2_GROUP_SLOTS   8
+#define SBUS2_SLOT_US     660
+
+typedef struct {
+    uint16 channels[SBUS_CHANNELS + 2];   // 17 and 18 are digital, 1000 or 2000
+    uint8  flags;
+} sbus_frame;
+
+void sbus_decode(const uint8 frame[], sbus_frame *out);
+void sbus_encode(const sbus_frame *in, uint8 frame[]);
+uint8 sbus2_slot_id(uint8 slot);
+uint8 sbus2_slot_of(uint8 id);      // 0xff if not a slot id
+
+#endif
@@ -0,0 +1,343 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "sbus_rx.h"
+#include "timebase.h"
+
+#define SYSTICK_SLOT   2            // 0 is idle, 1 is timebase
+#define NO_GROUP    0xff
+#define UART_ERRORS    (UART_in_INTR_RX_OVERFLOW | UART_in_INTR_RX_FRAME_ERROR \
+                        | UART_in_INTR_RX_PARITY_ERROR)
+
+volatile sbus_rx_counters sbus_rx_count;
+volatile sbus_rx_polarity sbus_rx_pol;
+
+static sbus_rx_frame queue[SBUS_RX_QUEUE];
+static volatile uint8 head;         // written by the tick
+static volatile uint8 tail;         // written by the main loop
+
+static uint8 chunk[SBUS_FRAME_LEN];
+static uint8 len;                   // bytes since the gap, saturates
+static uint8 hunting;               // started mid-frame, wait for a gap
+static uint8 damaged;               // UART error inside this chunk
+static uint32 chunk_start, last_byte;
+
+static sbus_rx_telemetry telem;
+static uint8 slot_group = NO_GROUP;          // SBUS2 slots arriving, or NO_GROUP
+static uint8 slot_pos;              // 0 waits for an id, 1 and 2 data
+static uint8 slot_cur;              // slot being read, NO_GROUP if mistimed
+static uint8 slot_next;             // lowest slot that may come next
+static uint8 slot_data[2];
+static uint8 grid_set;
+static int32 grid;                  // us from the end byte to slot 0 of the group
+static uint32 cycle_bits;
+static uint32 frame_end;
+
+static uint8 run;                   // good frames in a row while verifying
+static uint8 bad;                   // bad chunks since the polarity was set
+static uint8 samples, highs;
+static uint32 search_start, last_sample, last_good;
+
+
+static void queue_frame(uint32 end)
+{
+    sbus_rx_frame *f;
+
+    if ((uint8)(head - tail) >= SBUS_RX_QUEUE) {
+        sbus_rx_count.dropped += 1;
+        return;
+    }
+    f = &queue[head & (SBUS_RX_QUEUE - 1)];
+    memcpy(f->data, chunk, SBUS_FRAME_LEN);
+    f->start = chunk_start;
+    f->end = end;
+    head += 1;                      // publish after the copy
+    sbus_rx_count.frames += 1;
+}
+
+// Sets Control1 and starts framing afresh, bytes in the FIFO were read
+// with the old polarity
+static void set_polarity(uint8 polarity, uint32 now)
+{
+    sbus_rx_pol.polarity = polarity;
+    Control1_Write(polarity);
+    UART_in_SpiUartClearRxBuffer();
+    UART_in_ClearRxInterruptSource(UART_ERRORS);
+    len = 0;
+    hunting = 1;
+    damaged = 0;
+    slot_group = NO_GROUP;
+    run = 0;
+    bad = 0;
+    last_byte = now;
+    last_good = now;
+}
+
+static void start_sampling(uint32 now)
+{
+    sbus_rx_pol.state = SBUS_RX_SAMPLING;
+    samples = 0;
+    highs = 0;
+    last_sample = now;
+    search_start = now;
+}
+
+// Returns 1 when the frame may be queued
+static uint8 good_frame(uint32 now)
+{
+    last_good = now;
+    if (sbus_rx_pol.state == SBUS_RX_SAMPLING)
+        return 0;
+    if (sbus_rx_pol.state != SBUS_RX_VERIFYING)
+        return 1;
+    if (++run < SBUS_RX_LOCK)
+        return 0;
+    sbus_rx_pol.state = SBUS_RX_LOCKED;
+    sbus_rx_pol.lock_us = now - search_start;
+    sbus_rx_pol.locks += 1;
+    return 1;
+}
+
+static void polarity_tick(uint32 now)
+{
+    switch (sbus_rx_pol.state) {
+    case SBUS_RX_SAMPLING:
+        if (now - last_sample < SBUS_RX_SAMPLE_US)
+            break;
+        last_sample = now;
+        highs += UART_input_Read() ? 1 : 0;
+        if (++samples < SBUS_RX_SAMPLES)
+            break;
+        sbus_rx_pol.sampled = highs > SBUS_RX_SAMPLES / 2 ? SBUS_RX_IDLE_HIGH : SBUS_RX_IDLE_LOW;
+        sbus_rx_pol.state = SBUS_RX_VERIFYING;
+        set_polarity(sbus_rx_pol.sampled, now);
+        break;
+    case SBUS_RX_VERIFYING:
+        // the wrong polarity reads as framing errors with no gaps, so
+        // the time limit catches what the bad count does not
+        if (bad >= SBUS_RX_BAD || now - last_good > SBUS_RX_VERIFY) {
+            sbus_rx_pol.flips += 1;
+            set_polarity(!sbus_rx_pol.polarity, now);
+        }
+        break;
+    case SBUS_RX_LOCKED:
+        if (now - last_good > SBUS_RX_TIMEOUT)
+            start_sampling(now);
+        break;
+    }
+}
+
+static void end_slots(void)
+{
+    uint32 mask = 0xffUL << (slot_group * SBUS2_GROUP_SLOTS);
+
+    telem.occupied = (telem.occupied & ~mask) | cycle_bits;
+    slot_group = NO_GROUP;
+}
+
+static void start_slots(uint8 group, uint32 end)
+{
+    slot_group = group;
+    slot_pos = 0;
+    slot_next = group * SBUS2_GROUP_SLOTS;
+    grid_set = 0;
+    cycle_bits = 0;
+    frame_end = end;
+    telem.cycles += 1;
+}
+
+// Returns 0 when the byte is not telemetry and ends the slots
+static uint8 slot_byte(uint8 b, uint32 now)
+{
+    uint8 slot;
+    int32 offset, step;
+
+    if (slot_pos && now - last_byte > SBUS_RX_GAP) {
+        telem.cut += 1;
+        slot_pos = 0;
+    }
+    if (slot_pos) {
+        slot_data[slot_pos - 1] = b;
+        if (++slot_pos < 3)
+            return 1;
+        slot_pos = 0;
+        if (slot_cur != NO_GROUP) {
+            telem.data[slot_cur][0] = slot_data[0];
+            telem.data[slot_cur][1] = slot_data[1];
+            telem.slots += 1;
+            cycle_bits |= 1UL << slot_cur;
+        }
+        return 1;
+    }
+
+    slot = sbus2_slot_of(b);
+    if (slot == 0xff || slot / SBUS2_GROUP_SLOTS != slot_group || slot < slot_next) {
+        end_slots();
+        return 0;
+    }
+    offset = now - frame_end;
+    step = (slot % SBUS2_GROUP_SLOTS) * SBUS2_SLOT_US;
+    if (!grid_set) {
+        grid = offset - step;
+        grid_set = 1;
+    }
+    offset -= grid + step;
+    if (offset > SBUS_RX_SLOT_SLACK || offset < -SBUS_RX_SLOT_SLACK) {
+        telem.mistimed += 1;
+        slot_cur = NO_GROUP;
+    } else {
+        slot_cur = slot;
+        telem.offset[slot] = now - frame_end;
+    }
+    slot_next = slot + 1;
+    slot_pos = 1;
+    return 1;
+}
+
+static void end_chunk(void)
+{
+    if (len && !hunting) {
+        if (len != SBUS_FRAME_LEN || damaged)
+            sbus_rx_count.resyncs += 1;
+        else if (chunk[0] != 0x0f)
+            sbus_rx_count.header_errors += 1;
+        else
+            sbus_rx_count.footer_errors += 1;
+        run = 0;
+        if (bad < 0xff)
+            bad += 1;
+    }
+    len = 0;
+    hunting = 0;
+    damaged = 0;
+}
+
+static void drain(void)
+{
+    uint32 now = timebase_us();
+    uint32 status = UART_in_GetRxInterruptSource() & UART_ERRORS;
+    uint8 b;
+
+    if (status) {
+        UART_in_ClearRxInterruptSource(status);
+        sbus_rx_count.errors += 1;
+        damaged = 1;
+    }
+    if ((len || hunting) && now - last_byte > SBUS_RX_GAP)
+        end_chunk();
+
+    while (UART_in_SpiUartGetRxBufferSize()) {
+        b = UART_in_UartGetByte();
+        if (slot_group != NO_GROUP && len == 0 && slot_byte(b, now)) {
+            last_byte = now;
+            continue;
+        }
+        if (len < SBUS_FRAME_LEN)
+            chunk[len] = b;
+        if (len == 0)
+            chunk_start = now;
+        if (len < 0xff)
+            len += 1;
+        last_byte = now;
+
+        // a good frame goes out without waiting for the gap, bytes right
+        // behind it start the next chunk
+        if (len == SBUS_FRAME_LEN && !hunting && !damaged
+            && chunk[0] == 0x0f && SBUS_END_OK(chunk[SBUS_FRAME_LEN - 1])) {
+            if (good_frame(now))
+                queue_frame(now);
+            len = 0;
+            if (slot_group != NO_GROUP)
+                end_slots();
+            if (SBUS2_END(chunk[SBUS_FRAME_LEN - 1]))
+                start_slots(SBUS2_GROUP(chunk[SBUS_FRAME_LEN - 1]), now);
+        }
+    }
+
+    if (sbus_rx_pol.state != SBUS_RX_FIXED)
+        polarity_tick(now);
+}
+
+static void sbus_rx_tick(void)
+{
+    drain();
+}
+
+// Drains the FIFO now, for loops that spin while timing a frame
+void sbus_rx_poll(void)
+{
+    uint8 intr = CyEnterCriticalSection();
+
+    drain();
+    CyExitCriticalSection(intr);
+}
+
+static void start(uint8 automatic)
+{
+    uint8 intr = CyEnterCriticalSection();
+    uint32 now = timebase_us();
+
+    UART_in_SpiUartClearRxBuffer();
+    UART_in_ClearRxInterruptSource(UART_ERRORS);
+    memset((void *)&sbus_rx_count, 0, sizeof(sbus_rx_count));
+    memset(&telem, 0, sizeof(telem));
+    memset((void *)&sbus_rx_pol, 0, sizeof(sbus_rx_pol));
+    sbus_rx_pol.polarity = Control1_Read();
+    slot_group = NO_GROUP;
+    head = tail = 0;
+    len = 0;
+    damaged = 0;
+    hunting = 1;
+    last_byte = now;
+    if (automatic)
+        start_sampling(now);
+    CySysTickSetCallback(SYSTICK_SLOT, sbus_rx_tick);
+    CyExitCriticalSection(intr);
+}
+
+// Control1 as the caller set it
+void sbus_rx_start(void)
+{
+    start(0);
+}
+
+void sbus_rx_start_auto(void)
+{
+    start(1);
+}
+
+void sbus_rx_stop(void)
+{
+    CySysTickSetCallback(SYSTICK_SLOT, NULL);
+}
+
+// Main loop side of the frame queue, returns 0 when empty
+uint8 sbus_rx_get(sbus_rx_frame *f)
+{
+    if (tail == head)
+        return 0;
+    *f = queue[tail & (SBUS_RX_QUEUE - 1)];
+    tail += 1;
+    return 1;
+}
+
+// Copy of the telemetry so far, slots keep changing under the tick
+void sbus_rx_get_telemetry(sbus_rx_telemetry *t)
+{
+    uint8 intr = CyEnterCriticalSection();
+
+    *t = telem;
+    CyExitCriticalSection(intr);
+}
@@ -0,0 +1,115 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SBUS_RX_H_
+#define _SBUS_RX_H_
+
+#include <project.h>
+#include "sbus.h"
+
+// SBUS framing on UART_in.  UART_in has no interrupt in the schematic, so
+// the idle SysTick drains its FIFO (idle_tick_start() and timebase_start()
+// first).  At 200us per tick and 120us per byte the 8-byte FIFO cannot
+// overrun.  Each byte is stamped with timebase_us() when it is drained,
+// so stamps have tick resolution; loops that need better call
+// sbus_rx_poll() while they spin.
+//
+// Frames are delimited by the idle gap before them: bytes come back to
+// back inside a frame and the gap is 4ms or more in both the 14ms and 7ms
+// modes.  A chunk is queued as soon as it is 25 bytes with the 0x0f
+// header and an SBUS or SBUS2 end byte.  Anything else between two gaps is
+// counted as a resync, or a header or footer error when the length was
+// right, and thrown away, so 0x0f in channel data cannot mis-sync.
+//
+// After an SBUS2 frame the bytes up to the next frame are telemetry.  A
+// slot is an id byte from the frame's group of eight, taken in order, and
+// two data bytes; the first slot heard sets the 660us grid and later ones
+// must start within SBUS_RX_SLOT_SLACK of it.  Any other byte in place of
+// an id ends the slots and is framed as usual.
+//
+// sbus_rx_start_auto() finds the polarity instead of taking Control1 as
+// set.  The pad on P3.0 is sampled for SBUS_RX_SAMPLES ticks; the line
+// is idle most of a frame period, so the majority level is the idle
+// level.  Control1 is set to match and SBUS_RX_LOCK good frames in a row
+// confirm it.  SBUS_RX_BAD bad chunks or SBUS_RX_VERIFY without a good
+// frame flip the polarity and try again.  Frames are only queued once
+// locked, and SBUS_RX_TIMEOUT without one starts over, so a fixture can
+// swap receivers without restarting the mode.
+
+#define SBUS_RX_QUEUE        8      // frames, power of two
+#define SBUS_RX_GAP       1000      // us of silence that ends a frame
+#define SBUS_RX_SLOT_SLACK 400      // us, covers the tick when not polled
+
+#define SBUS_RX_SAMPLE_US  200      // between idle level samples
+#define SBUS_RX_SAMPLES    100      // 20ms, more than one 14ms period
+#define SBUS_RX_LOCK         3      // good frames in a row
+#define SBUS_RX_BAD          3      // bad chunks that flip the polarity
+#define SBUS_RX_VERIFY   40000      // us without a good frame that flips it
+#define SBUS_RX_TIMEOUT 500000      // us without a good frame once locked
+
+// Control1 values
+#define SBUS_RX_IDLE_LOW     0      // SBUS as specified
+#define SBUS_RX_IDLE_HIGH    1      // inverted by the receiver, plain UART
+
+// sbus_rx_polarity.state
+#define SBUS_RX_FIXED        0      // sbus_rx_start(), Control1 as set
+#define SBUS_RX_SAMPLING     1
+#define SBUS_RX_VERIFYING    2
+#define SBUS_RX_LOCKED       3
+
+typedef struct {
+    uint8  data[SBUS_FRAME_LEN];
+    uint32 start;                   // timebase_us() of the first byte
+    uint32 end;                     // and of the end byte
+} sbus_rx_frame;
+
+typedef struct {
+    uint32 frames;                  // queued
+    uint32 dropped;                 // good frames lost to a full queue
+    uint32 resyncs;                 // bytes between gaps that were not a frame
+    uint32 header_errors;           // 25 bytes between gaps, first not 0x0f
+    uint32 footer_errors;           // 25 bytes between gaps, bad end byte
+    uint32 errors;                  // UART overflow, framing or parity error
+} sbus_rx_counters;
+
+extern volatile sbus_rx_counters sbus_rx_count;
+
+typedef struct {
+    uint8  state;
+    uint8  polarity;                // Control1 now
+    uint8  sampled;                 // idle level the pad showed
+    uint32 lock_us;                 // search time of the last lock
+    uint32 locks;
+    uint32 flips;                   // guesses the frames did not confirm
+} sbus_rx_polarity;
+
+extern volatile sbus_rx_polarity sbus_rx_pol;
+
+typedef struct {
+    uint32 occupied;                // slots heard in the last cycle of their group
+    uint32 cycles;                  // SBUS2 frames
+    uint32 slots;                   // slots decoded
+    uint32 mistimed;                // slot ids off the 660us grid
+    uint32 cut;                     // slots with a gap inside
+    uint8  data[SBUS2_SLOTS][2];    // from the last time each slot was heard
+    uint16 offset[SBUS2_SLOTS];     // us from the end byte to the slot id
+} sbus_rx_telemetry;
+
+void  sbus_rx_start(void);
+void  sbus_rx_start_auto(void);
+void  sbus_rx_stop(void);
+void  sbus_rx_poll(void);
+uint8 sbus_rx_get(sbus_rx_frame *f);
+void  sbus_rx_get_telemetry(sbus_rx_telemetry *t);
+
+#endif
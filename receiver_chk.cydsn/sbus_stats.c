@@ -0,0 +1,91 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "sbus_stats.h"
+
+void sbus_stats_clear(sbus_stats *s)
+{
+    memset(s, 0, sizeof *s);
+    s->interval_min = 0xffffffff;
+}
+
+void sbus_stats_add(sbus_stats *s, uint8 flags, uint32 start)
+{
+    uint32 interval, jitter;
+
+    s->frames += 1;
+    if (flags & SBUS_FLAG_LOST)
+        s->lost += 1;
+    if (flags & SBUS_FLAG_FAILSAFE) {
+        s->failsafe += 1;
+        if (!(s->last_flags & SBUS_FLAG_FAILSAFE))
+            s->failsafe_entries += 1;
+    }
+    s->last_flags = flags;
+
+    if (s->timed) {
+        interval = start - s->last_start;
+        if (interval > SBUS_STATS_OUTAGE) {
+            s->outages += 1;
+            s->chained = 0;
+        } else {
+            s->intervals += 1;
+            s->interval_sum += interval;
+            if (interval < s->interval_min)
+                s->interval_min = interval;
+            if (interval > s->interval_max)
+                s->interval_max = interval;
+            if (s->chained) {
+                jitter = interval > s->last_interval ? interval - s->last_interval
+                                                     : s->last_interval - interval;
+                s->jitters += 1;
+                s->jitter_sum += jitter;
+            }
+            s->last_interval = interval;
+            s->chained = 1;
+        }
+    }
+    s->last_start = start;
+    s->timed = 1;
+}
+
+void sbus_stats_merge(sbus_stats *total, const sbus_stats *window)
+{
+    total->frames += window->frames;
+    total->lost += window->lost;
+    total->failsafe += window->failsafe;
+    total->failsafe_entries += window->failsafe_entries;
+    total->outages += window->outages;
+    total->intervals += window->intervals;
+    total->jitters += window->jitters;
+    if (window->interval_min < total->interval_min)
+        total->interval_min = window->interval_min;
+    if (window->interval_max > total->interval_max)
+        total->interval_max = window->interval_max;
+}
+
+// Empties the window but keeps the last frame, so the first interval and
+// failsafe edge of the next window are still seen
+void sbus_stats_next(sbus_stats *window)
+{
+    sbus_stats keep = *window;
+
+    sbus_stats_clear(window);
+    window->last_start = keep.last_start;
+    window->last_interval = keep.last_interval;
+    window->last_flags = keep.last_flags;
+    window->timed = keep.timed;
+    window->chained = keep.chained;
+}
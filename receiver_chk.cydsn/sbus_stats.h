@@ -0,0 +1,58 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SBUS_STATS_H_
+#define _SBUS_STATS_H_
+
+#include "sbus.h"
+
+// Running SBUS link statistics for soak tests.  Frames go into a window
+// with sbus_stats_add(); once a second the window is reported, folded
+// into the run totals with sbus_stats_merge() and restarted with
+// sbus_stats_next().  Only counts, min and max are kept for the run, the
+// sums behind the mean interval and jitter would wrap in a long soak.
+//
+// The interval is between first-byte stamps.  Jitter is the mean change
+// from one interval to the next, so a steady offset from the nominal
+// 14ms or 7ms is not counted.  A gap longer than SBUS_STATS_OUTAGE is an
+// outage rather than an interval and restarts the jitter chain.
+
+#define SBUS_STATS_OUTAGE   100000  // us
+
+typedef struct {
+    uint32 frames;
+    uint32 lost;                    // frames with the frame lost flag
+    uint32 failsafe;                // frames with the failsafe flag
+    uint32 failsafe_entries;        // times the failsafe flag came on
+    uint32 outages;
+    uint32 intervals;
+    uint32 interval_sum;            // us, window only
+    uint32 interval_min;
+    uint32 interval_max;
+    uint32 jitters;
+    uint32 jitter_sum;              // us, window only
+
+    // carried from window to window
+    uint32 last_start;
+    uint32 last_interval;
+    uint8  last_flags;
+    uint8  timed;                   // last_start is valid
+    uint8  chained;                 // last_interval is valid
+} sbus_stats;
+
+void sbus_stats_clear(sbus_stats *s);
+void sbus_stats_add(sbus_stats *s, uint8 flags, uint32 start);
+void sbus_stats_merge(sbus_stats *total, const sbus_stats *window);
+void sbus_stats_next(sbus_stats *window);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sbus_tx.h"
+
+#define BIT_US          10
+#define CHAN_RANGE   10000
+#define SBUS_RANGE     819          // 992 +/- 819 is 173..1811
+
+// SBUS_RANGE / CHAN_RANGE as a multiply and shift, rounded to the nearest
+// step; no divider on the M0 and this runs for 16 channels every frame
+#define SCALE_SHIFT     20
+#define SCALE_MUL       (((SBUS_RANGE << SCALE_SHIFT) + CHAN_RANGE - 1) / CHAN_RANGE)
+
+volatile uint8  sbus_tx_flags;
+volatile uint32 sbus_tx_frames;
+
+static uint16 period;
+static uint8 inverted;
+static uint8 frame[SBUS_FRAME_LEN];
+static uint8 next_byte;
+static uint8 built;
+static sbus_frame out;
+
+
+static uint16 to_sbus(int32 value)
+{
+    uint32 scaled;
+
+    if (value > CHAN_RANGE)
+        value = CHAN_RANGE;
+    if (value < -CHAN_RANGE)
+        value = -CHAN_RANGE;
+    scaled = ((uint32)(value < 0 ? -value : value) * SCALE_MUL + (1UL << (SCALE_SHIFT - 1))) >> SCALE_SHIFT;
+    return value < 0 ? SBUS_CENTER - scaled : SBUS_CENTER + scaled;
+}
+
+static void build(volatile int32 channels[])
+{
+    uint8 i;
+
+    for (i = 0; i < SBUS_CHANNELS; i++)
+        out.channels[i] = to_sbus(channels[i]);
+    out.channels[16] = channels[16] > 0 ? 2000 : 1000;
+    out.channels[17] = channels[17] > 0 ? 2000 : 1000;
+    out.flags = sbus_tx_flags;
+    sbus_encode(&out, frame);
+}
+
+// Start bit, eight data bits LSB first, even parity and two stop bits.
+// SBUS proper is the inverse of a UART, idle low.
+static void send_byte(uint8 data)
+{
+    uint16 word = (uint16)data << 1;
+    uint8 parity = data, level, i, intr;
+    uint32 start, edge, now;
+
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+    word |= (uint16)(parity & 1) << 9;
+    word |= 3 << 10;
+    if (!inverted)
+        word = ~word;
+
+    // a late entry can see the count wrap at the period mid-byte, give up
+    // on the timing then rather than wait for an edge that never comes
+    intr = CyEnterCriticalSection();
+    start = proto_timer_ReadCounter();
+    edge = start + 1;
+    for (i = 0; i < 12; i++) {
+        level = (word >> i) & 1;
+        do {
+            now = proto_timer_ReadCounter();
+        } while (now < edge && now >= start);
+        Pin_testout_Write(level);
+        edge += BIT_US;
+    }
+    CyExitCriticalSection(intr);
+}
+
+void sbus_tx_init(uint16 frame_period, uint8 invert)
+{
+    period = frame_period;
+    inverted = invert;
+    next_byte = 0;
+    built = 0;
+    sbus_tx_frames = 0;
+    Pin_testout_Write(inverted ? 1 : 0);
+}
+
+// Protocol timer callback, returns us to the next byte or frame.  The next
+// frame is built after the last byte, in the long gap between frames: a
+// byte tick has no room for it on top of the 110us the byte takes.  The
+// first call after init only builds.
+uint16 sbus_tx_callback(volatile int32 channels[])
+{
+    if (!built) {
+        build(channels);
+        built = 1;
+        return SBUS_TX_BYTE_US;
+    }
+    send_byte(frame[next_byte]);
+    if (++next_byte < SBUS_FRAME_LEN)
+        return SBUS_TX_BYTE_US;
+
+    next_byte = 0;
+    sbus_tx_frames += 1;
+    build(channels);
+    return period - (SBUS_FRAME_LEN - 1) * SBUS_TX_BYTE_US;
+}
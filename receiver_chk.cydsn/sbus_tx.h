@@ -0,0 +1,38 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SBUS_TX_H_
+#define _SBUS_TX_H_
+
+#include <project.h>
+#include "sbus.h"
+
+// SBUS output on Pin_testout (P1.5).  There is no spare UART, so the
+// protocol timer callback bit-bangs one byte per tick at 100000 baud 8E2,
+// timing the edges from the 1MHz timer count with interrupts off for the
+// 110us the byte takes.  A wire from P1.5 to UART_in (P3.0) loops the
+// output back to the SBUS monitor and latency modes.
+//
+// Channels are in the -10000..10000 range used by the nRF24 engines and
+// map to 173..1811; channels[16] and [17] above zero set the digital
+// channels.
+
+#define SBUS_TX_BYTE_US     125     // byte plus a short extra stop
+
+extern volatile uint8  sbus_tx_flags;     // SBUS_FLAG_LOST, SBUS_FLAG_FAILSAFE
+extern volatile uint32 sbus_tx_frames;
+
+void   sbus_tx_init(uint16 period, uint8 inverted);
+uint16 sbus_tx_callback(volatile int32 channels[]);
+
+#endif
@@ -0,0 +1,214 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "serial_proto.h"
+
+#define IBUS_LEN        32
+#define IBUS_CHANNELS   14
+#define SUMD_HEADER   0xa8
+#define SUMD_VALID    0x01
+#define SUMD_FAILSAFE 0x81
+#define DSM_LEN         16
+#define DSM_CHANNELS    12
+
+// CCITT polynomial 0x1021, zero start, as SUMD uses it
+static const uint16 crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+uint16 serial_crc16(const uint8 buf[], uint8 len)
+{
+    uint16 crc = 0;
+
+    while (len--)
+        crc = (crc << 8) ^ crc16_table[(crc >> 8) ^ *buf++];
+    return crc;
+}
+
+static void set_channel(serial_frame *out, uint8 ch, uint16 us)
+{
+    if (ch >= SERIAL_CHANNELS)
+        return;
+    out->channels[ch] = us;
+    if (ch >= out->num_channels)
+        out->num_channels = ch + 1;
+}
+
+
+// Futaba SBUS, 100000 baud 8E2 inverted
+static uint8 sbus_length(const uint8 buf[], uint8 len)
+{
+    (void)len;
+    return buf[0] == 0x0f ? SBUS_FRAME_LEN : 0;
+}
+
+static uint8 sbus_check(const uint8 buf[], uint8 len, serial_frame *out)
+{
+    sbus_frame sbus;
+    uint8 i;
+
+    if (len != SBUS_FRAME_LEN || buf[0] != 0x0f || !SBUS_END_OK(buf[SBUS_FRAME_LEN - 1]))
+        return 0;
+    sbus_decode(buf, &sbus);
+    // 172..1811 is 988..2012us
+    for (i = 0; i < SBUS_CHANNELS; i++)
+        set_channel(out, i, 880 + sbus.channels[i] * 5 / 8);
+    set_channel(out, 16, sbus.channels[16]);
+    set_channel(out, 17, sbus.channels[17]);
+    out->flags = 0;
+    if (sbus.flags & SBUS_FLAG_LOST)
+        out->flags |= SERIAL_FLAG_LOST;
+    if (sbus.flags & SBUS_FLAG_FAILSAFE)
+        out->flags |= SERIAL_FLAG_FAILSAFE;
+    return 1;
+}
+
+// FlySky IBUS, 115200 8N1: 0x20 0x40, 14 little-endian channels in us and
+// 0xffff less the byte sum
+static uint8 ibus_length(const uint8 buf[], uint8 len)
+{
+    if (buf[0] != 0x20 || (len > 1 && buf[1] != 0x40))
+        return 0;
+    return IBUS_LEN;
+}
+
+static uint8 ibus_check(const uint8 buf[], uint8 len, serial_frame *out)
+{
+    uint16 sum = 0xffff;
+    uint8 i;
+
+    if (len != IBUS_LEN || buf[0] != 0x20 || buf[1] != 0x40)
+        return 0;
+    for (i = 0; i < IBUS_LEN - 2; i++)
+        sum -= buf[i];
+    if (sum != (buf[IBUS_LEN - 2] | (uint16)buf[IBUS_LEN - 1] << 8))
+        return 0;
+    for (i = 0; i < IBUS_CHANNELS; i++)
+        set_channel(out, i, (buf[2 + 2*i] | (uint16)buf[3 + 2*i] << 8) & 0x0fff);
+    out->flags = 0;
+    return 1;
+}
+
+// Graupner SUMD, 115200 8N1: 0xa8, status, channel count, big-endian
+// channels in 1/8us and a CRC16 over the rest
+static uint8 sumd_length(const uint8 buf[], uint8 len)
+{
+    if (buf[0] != SUMD_HEADER)
+        return 0;
+    if (len > 1 && buf[1] != SUMD_VALID && buf[1] != SUMD_FAILSAFE)
+        return 0;
+    if (len < 3)
+        return SERIAL_MAX_FRAME;    // not known yet, keep reading
+    if (buf[2] < 2 || buf[2] > 32)
+        return 0;
+    return 5 + 2 * buf[2];
+}
+
+static uint8 sumd_check(const uint8 buf[], uint8 len, serial_frame *out)
+{
+    uint8 i;
+
+    if (len < 3 || len != sumd_length(buf, len))
+        return 0;
+    if (serial_crc16(buf, len - 2) != ((uint16)buf[len - 2] << 8 | buf[len - 1]))
+        return 0;
+    for (i = 0; i < buf[2]; i++)
+        set_channel(out, i, ((uint16)buf[3 + 2*i] << 8 | buf[4 + 2*i]) >> 3);
+    out->flags = buf[1] == SUMD_FAILSAFE ? SERIAL_FLAG_FAILSAFE : 0;
+    return 1;
+}
+
+// Spektrum remote receiver serial, 115200 8N1: fades, system, then seven
+// big-endian words of channel id and value.  There is no header or check,
+// so only a 16 byte burst between gaps with a known system byte and sane
+// channel ids counts.
+static uint8 dsm_2048(uint8 system)
+{
+    return system == 0x12 || system == 0xa2 || system == 0xb2;
+}
+
+static uint8 dsm_length(const uint8 buf[], uint8 len)
+{
+    if (len > 1 && buf[1] != 0x01 && !dsm_2048(buf[1]))
+        return 0;
+    return DSM_LEN;
+}
+
+static uint8 dsm_check(const uint8 buf[], uint8 len, serial_frame *out)
+{
+    uint8 shift, i, id;
+    uint16 word, value[7];
+    uint8 ids[7];
+
+    if (len != DSM_LEN || (buf[1] != 0x01 && !dsm_2048(buf[1])))
+        return 0;
+    shift = dsm_2048(buf[1]) ? 11 : 10;
+    for (i = 0; i < 7; i++) {
+        word = (uint16)buf[2 + 2*i] << 8 | buf[3 + 2*i];
+        ids[i] = 0xff;
+        if (word == 0xffff)
+            continue;
+        id = (word >> shift) & 0x0f;
+        if (id >= DSM_CHANNELS)
+            return 0;
+        ids[i] = id;
+        value[i] = word & ((1 << shift) - 1);
+    }
+    // 1024 steps are 1us, 2048 half that, both from 988us
+    for (i = 0; i < 7; i++)
+        if (ids[i] != 0xff)
+            set_channel(out, ids[i], 988 + (shift == 11 ? value[i] >> 1 : value[i]));
+    out->flags = 0;
+    return 1;
+}
+
+// Checksummed protocols first, Spektrum has nothing to check but shape
+const serial_proto serial_protos[] = {
+    {"SBUS", 100000, SERIAL_8E2, 1, 0, sbus_length, sbus_check},
+    {"IBUS", 115200, SERIAL_8N1, 0, 0, ibus_length, ibus_check},
+    {"SUMD", 115200, SERIAL_8N1, 0, 0, sumd_length, sumd_check},
+    {"DSM",  115200, SERIAL_8N1, 0, 1, dsm_length,  dsm_check},
+};
+const uint8 serial_num_protos = sizeof(serial_protos) / sizeof(serial_protos[0]);
@@ -0,0 +1,60 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SERIAL_PROTO_H_
+#define _SERIAL_PROTO_H_
+
+#include "sbus.h"
+
+// Serial receiver protocols, one table entry each.  The decoders have no
+// hardware dependencies and build on a host with -DEMULATOR (see
+// host/serial_bench.c); serial_rx does the UART side and detection.
+//
+// Every decoder publishes into serial_frame, channels in microseconds.
+// Decoders update only the channels a frame carries, so Spektrum frames
+// that split the channels over two packets still fill in the whole set.
+
+#define SERIAL_CHANNELS      18
+#define SERIAL_MAX_FRAME     69     // SUMD with 32 channels
+
+#define SERIAL_8N1            0
+#define SERIAL_8E2            1
+
+#define SERIAL_FLAG_LOST   0x01
+#define SERIAL_FLAG_FAILSAFE 0x02
+
+typedef struct {
+    uint16 channels[SERIAL_CHANNELS];
+    uint8  num_channels;            // highest channel seen + 1
+    uint8  flags;
+} serial_frame;
+
+typedef struct {
+    const char *name;
+    uint32 baud;
+    uint8  format;                  // SERIAL_8N1 or SERIAL_8E2
+    uint8  inverted;                // idle low on the wire, as SBUS
+    uint8  gap_only;                // no header, only a gap ends a frame
+    // frame length from the bytes so far, 0 if not known yet or not this
+    // protocol
+    uint8  (*length)(const uint8 buf[], uint8 len);
+    // checks a whole frame, returns 0 if it is not valid
+    uint8  (*decode)(const uint8 buf[], uint8 len, serial_frame *out);
+} serial_proto;
+
+extern const serial_proto serial_protos[];
+extern const uint8 serial_num_protos;
+
+uint16 serial_crc16(const uint8 buf[], uint8 len);
+
+#endif
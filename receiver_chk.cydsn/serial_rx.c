@@ -0,0 +1,267 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "serial_rx.h"
+#include "timebase.h"
+
+#define SYSTICK_SLOT   2            // 0 is idle, 1 is timebase
+#define UART_ERRORS    (UART_in_INTR_RX_OVERFLOW | UART_in_INTR_RX_FRAME_ERROR \
+                        | UART_in_INTR_RX_PARITY_ERROR)
+#define CONTROL_IDLE_LOW  0         // Control1 for an idle-low line, SBUS normal
+
+// RX_CTRL stop bits count half bits less one.  The receiver only needs the
+// first stop bit, so 8E2 is read as 8E1.
+#define RX_STOP_1BIT   1
+
+// Spektrum at 22ms is the slowest, SBUS at 14ms
+const serial_rx_setting serial_rx_settings[] = {
+    {100000, SERIAL_8E2, 1,  60000},
+    {100000, SERIAL_8E2, 0,  60000},
+    {115200, SERIAL_8N1, 0, 100000},
+    {115200, SERIAL_8N1, 1, 100000},
+};
+#define NUM_SETTINGS (sizeof(serial_rx_settings) / sizeof(serial_rx_settings[0]))
+
+volatile serial_rx_status serial_rx_state;
+
+static serial_rx_frame queue[SERIAL_RX_QUEUE];
+static volatile uint8 head;         // written by the tick
+static volatile uint8 tail;         // written by the main loop
+
+static uint8 chunk[SERIAL_MAX_FRAME];
+static uint8 len;
+static uint8 hunting;               // started mid-frame, wait for a gap
+static uint8 damaged;               // UART error inside this chunk
+static uint8 candidates;            // protocols this chunk may still be
+static uint32 last_byte;
+
+static serial_frame work;           // decoders update channels in place
+static uint8 run_proto, run;        // good frames in a row while searching
+static uint8 bad;                   // chunks that failed on this setting
+static uint32 search_start, setting_start, last_good;
+
+
+// Oversampling 8..16 with the nearest whole clock divider, 115200 is
+// within 0.2% from 24 or 48MHz.  Also used by modes that know the setting.
+void serial_rx_configure(const serial_rx_setting *s)
+{
+    uint32 ovs, div, rate, err, best_err = 0xffffffff;
+    uint32 best_ovs = 16, best_div = 1, rx;
+
+    for (ovs = 8; ovs <= 16; ovs++) {
+        div = (CYDEV_BCLK__HFCLK__HZ + s->baud * ovs / 2) / (s->baud * ovs);
+        if (!div)
+            continue;
+        rate = CYDEV_BCLK__HFCLK__HZ / (div * ovs);
+        err = rate > s->baud ? rate - s->baud : s->baud - rate;
+        if (err < best_err) {
+            best_err = err;
+            best_ovs = ovs;
+            best_div = div;
+        }
+    }
+
+    UART_in_Stop();
+    UART_in_SCBCLK_SetDividerValue(best_div);
+    UART_in_CTRL_REG = (UART_in_CTRL_REG & ~UART_in_CTRL_OVS_MASK) | (best_ovs - 1);
+    rx = UART_in_UART_RX_CTRL_REG & ~(UART_in_UART_RX_CTRL_STOP_BITS_MASK
+                                      | UART_in_UART_RX_CTRL_PARITY
+                                      | UART_in_UART_RX_CTRL_PARITY_ENABLED);
+    rx |= RX_STOP_1BIT;
+    if (s->format == SERIAL_8E2)
+        rx |= UART_in_UART_RX_CTRL_PARITY_ENABLED;      // even
+    UART_in_UART_RX_CTRL_REG = rx;
+    Control1_Write(s->inverted ? CONTROL_IDLE_LOW : !CONTROL_IDLE_LOW);
+    UART_in_Start();
+    UART_in_SpiUartClearRxBuffer();
+    UART_in_ClearRxInterruptSource(UART_ERRORS);
+}
+
+static uint8 setting_protos(void)
+{
+    const serial_rx_setting *s = &serial_rx_settings[serial_rx_state.setting];
+    uint8 i, mask = 0;
+
+    if (serial_rx_state.proto != SERIAL_RX_NONE)
+        return 1 << serial_rx_state.proto;
+    for (i = 0; i < serial_num_protos; i++)
+        if (serial_protos[i].baud == s->baud && serial_protos[i].format == s->format)
+            mask |= 1 << i;
+    return mask;
+}
+
+static void use_setting(uint8 setting, uint32 now)
+{
+    serial_rx_state.setting = setting;
+    serial_rx_configure(&serial_rx_settings[setting]);
+    len = 0;
+    hunting = 1;
+    damaged = 0;
+    run = 0;
+    bad = 0;
+    last_byte = now;
+    setting_start = now;
+}
+
+static void queue_frame(uint8 proto, uint32 end)
+{
+    serial_rx_frame *f;
+
+    if ((uint8)(head - tail) >= SERIAL_RX_QUEUE) {
+        serial_rx_state.dropped += 1;
+        return;
+    }
+    f = &queue[head & (SERIAL_RX_QUEUE - 1)];
+    f->frame = work;
+    f->proto = proto;
+    f->end = end;
+    head += 1;                      // publish after the copy
+    serial_rx_state.frames += 1;
+}
+
+static void good_frame(uint8 proto, uint32 now)
+{
+    last_good = now;
+    if (serial_rx_state.proto == SERIAL_RX_NONE) {
+        if (proto != run_proto) {
+            run_proto = proto;
+            run = 0;
+        }
+        if (++run < SERIAL_RX_LOCK)
+            return;
+        serial_rx_state.proto = proto;
+        serial_rx_state.lock_us = now - search_start;
+        serial_rx_state.locks += 1;
+    }
+    queue_frame(proto, now);
+}
+
+// Tries the protocols still possible for the chunk, gap tells whether it
+// has ended.  Returns 1 when a frame was taken.
+static uint8 check_chunk(uint8 gap, uint32 now)
+{
+    const serial_proto *p;
+    uint8 i, want;
+
+    for (i = 0; i < serial_num_protos; i++) {
+        if (!(candidates & (1 << i)))
+            continue;
+        p = &serial_protos[i];
+        want = p->length(chunk, len);
+        if (!want || len > want) {
+            candidates &= ~(1 << i);
+            continue;
+        }
+        if (len == want && (gap || !p->gap_only) && p->decode(chunk, len, &work)) {
+            good_frame(i, now);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void end_chunk(uint32 now)
+{
+    if (len && !hunting) {
+        if (damaged || !check_chunk(1, now)) {
+            serial_rx_state.invalid += 1;
+            run = 0;
+            if (bad < 0xff)
+                bad += 1;
+        }
+    }
+    len = 0;
+    hunting = 0;
+    damaged = 0;
+}
+
+static void drain(void)
+{
+    uint32 now = timebase_us();
+    uint32 status = UART_in_GetRxInterruptSource() & UART_ERRORS;
+    uint8 b;
+
+    if (status) {
+        UART_in_ClearRxInterruptSource(status);
+        serial_rx_state.errors += 1;
+        damaged = 1;
+    }
+    if ((len || hunting) && now - last_byte > SERIAL_RX_GAP)
+        end_chunk(now);
+
+    while (UART_in_SpiUartGetRxBufferSize()) {
+        b = UART_in_UartGetByte();
+        last_byte = now;
+        if (len == 0)
+            candidates = setting_protos();
+        if (len >= SERIAL_MAX_FRAME) {
+            damaged = 1;            // nothing is this long, wait for the gap
+            continue;
+        }
+        chunk[len++] = b;
+        if (!hunting && !damaged && candidates && check_chunk(0, now))
+            len = 0;
+    }
+
+    // a wrong baud rate or polarity shows as garbage long before the dwell
+    if (serial_rx_state.proto == SERIAL_RX_NONE) {
+        if (bad >= SERIAL_RX_BAD
+            || now - setting_start > serial_rx_settings[serial_rx_state.setting].dwell)
+            use_setting((serial_rx_state.setting + 1) % NUM_SETTINGS, now);
+    } else if (now - last_good > SERIAL_RX_TIMEOUT) {
+        serial_rx_state.proto = SERIAL_RX_NONE;
+        memset(&work, 0, sizeof(work));
+        search_start = now;
+        setting_start = now;
+        run = 0;
+    }
+}
+
+static void serial_rx_tick(void)
+{
+    drain();
+}
+
+void serial_rx_start(void)
+{
+    uint8 intr = CyEnterCriticalSection();
+    uint32 now = timebase_us();
+
+    memset((void *)&serial_rx_state, 0, sizeof(serial_rx_state));
+    memset(&work, 0, sizeof(work));
+    serial_rx_state.proto = SERIAL_RX_NONE;
+    run_proto = SERIAL_RX_NONE;
+    head = tail = 0;
+    search_start = now;
+    use_setting(0, now);
+    CySysTickSetCallback(SYSTICK_SLOT, serial_rx_tick);
+    CyExitCriticalSection(intr);
+}
+
+void serial_rx_stop(void)
+{
+    CySysTickSetCallback(SYSTICK_SLOT, NULL);
+    serial_rx_configure(&serial_rx_settings[0]);
+}
+
+// Main loop side of the frame queue, returns 0 when empty
+uint8 serial_rx_get(serial_rx_frame *f)
+{
+    if (tail == head)
+        return 0;
+    *f = queue[tail & (SERIAL_RX_QUEUE - 1)];
+    tail += 1;
+    return 1;
+}
@@ -0,0 +1,73 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SERIAL_RX_H_
+#define _SERIAL_RX_H_
+
+#include <project.h>
+#include "serial_proto.h"
+
+// Serial receiver autodetection on UART_in.  The UART is set to each line
+// setting in turn, SBUS's 100000 8E2 and then 115200 8N1, each with both
+// polarities, and listens for its dwell time or until SERIAL_RX_BAD chunks
+// fail.  Bytes are framed as sbus_rx does, on the idle gap, and a frame is
+// checked by every protocol that uses the setting as soon as it has that
+// protocol's length.
+// SERIAL_RX_LOCK good frames in a row of one protocol lock onto it; from
+// then on only its frames are queued.  After SERIAL_RX_TIMEOUT without a
+// good frame the search starts again from the current setting.
+//
+// Shares SysTick slot 2 with sbus_rx, so only one of them runs at a time.
+// serial_rx_stop() leaves UART_in at 100000 8E2 for the SBUS modes.
+
+#define SERIAL_RX_QUEUE       4     // frames, power of two
+#define SERIAL_RX_GAP      1000     // us of silence that ends a frame
+#define SERIAL_RX_LOCK        3     // frames in a row
+#define SERIAL_RX_BAD         3     // bad chunks that end a setting early
+#define SERIAL_RX_TIMEOUT 500000    // us
+#define SERIAL_RX_NONE     0xff
+
+typedef struct {
+    uint32 baud;
+    uint8  format;
+    uint8  inverted;
+    uint32 dwell;                   // us, three frames of the slowest protocol
+} serial_rx_setting;
+
+extern const serial_rx_setting serial_rx_settings[];
+
+typedef struct {
+    serial_frame frame;
+    uint8  proto;                   // index into serial_protos
+    uint32 end;                     // timebase_us() of the last byte
+} serial_rx_frame;
+
+typedef struct {
+    uint8  proto;                   // locked protocol or SERIAL_RX_NONE
+    uint8  setting;                 // index into serial_rx_settings
+    uint32 lock_us;                 // search time of the last lock
+    uint32 locks;
+    uint32 frames;                  // queued
+    uint32 dropped;                 // good frames lost to a full queue
+    uint32 invalid;                 // bytes between gaps that were not a frame
+    uint32 errors;                  // UART overflow, framing or parity error
+} serial_rx_status;
+
+extern volatile serial_rx_status serial_rx_state;
+
+void  serial_rx_configure(const serial_rx_setting *s);
+void  serial_rx_start(void);
+void  serial_rx_stop(void);
+uint8 serial_rx_get(serial_rx_frame *f);
+
+#endif
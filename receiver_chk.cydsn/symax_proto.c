@@ -16,7 +16,6 @@
 #include <project.h>
 #include "nrf24l01.h"
 #include "protocols.h"
-#include <stdio.h>
 
 #define PROTOOPTS_X5C 0
 
@@ -34,15 +33,6 @@
 
 
 
-enum {
-    SYMAX_INIT1 = 0,
-    SYMAX_BIND2,
-    SYMAX_BIND3,
-    SYMAX_DATA
-};
-uint8 symax_phase = SYMAX_INIT1;
-
-    
 // For code readability
 enum {
     CHANNEL1 = 0,
@@ -60,13 +50,10 @@ enum {
 #define PAYLOADSIZE 10       // receive data pipes set to this size, but unused
 #define MAX_PACKET_SIZE 16   // X11,X12,X5C-1 10-byte, X5C 16-byte
 
-static uint8 packet[MAX_PACKET_SIZE];
 static uint8 packet_size;
 static uint32 packet_counter;
-static uint16 counter;
 static uint8 throttle, rudder, elevator, aileron, flags;
 static uint8 rx_tx_addr[5];
-static int32 Channels[8];   // simulate Deviation channels
 
 // frequency channel management
 #define MAX_RF_CHANNELS    17
@@ -96,9 +83,9 @@ static uint8 checksum(uint8 *data) {
 
 #define BABS(X) (((X) < 0) ? -(uint8)(X) : (X))
 // Channel values are sign + magnitude 8bit values
-static uint8 convert_channel(uint8 num)
+static uint8 convert_channel(proto_instance *p, uint8 num)
 {
-    int32 ch = Channels[num];
+    int32 ch = p->channels[num];
     if (ch < CHAN_MIN_VALUE) {
         ch = CHAN_MIN_VALUE;
     } else if (ch > CHAN_MAX_VALUE) {
@@ -108,34 +95,34 @@ static uint8 convert_channel(uint8 num)
 }
 
 
-static void read_controls(uint8* throttle, uint8* rudder, uint8* elevator, uint8* aileron, uint8* flags)
+static void read_controls(proto_instance *p, uint8* throttle, uint8* rudder, uint8* elevator, uint8* aileron, uint8* flags)
 {
-    *aileron  = convert_channel(CHANNEL1);
-    *elevator = convert_channel(CHANNEL2);
-    *throttle = convert_channel(CHANNEL3);
+    *aileron  = convert_channel(p, CHANNEL1);
+    *elevator = convert_channel(p, CHANNEL2);
+    *throttle = convert_channel(p, CHANNEL3);
     *throttle = *throttle & 0x80 ? 0xff - *throttle : 0x80 + *throttle;
-    *rudder   = convert_channel(CHANNEL4);
+    *rudder   = convert_channel(p, CHANNEL4);
 
     // Channel 5
-    if (Channels[CHANNEL5] <= 0)
+    if (p->channels[CHANNEL5] <= 0)
         *flags &= ~FLAG_FLIP;
     else
         *flags |= FLAG_FLIP;
 
     // Channel 6
-    if (Channels[CHANNEL6] <= 0)
+    if (p->channels[CHANNEL6] <= 0)
         *flags &= ~FLAG_RATES;
     else
         *flags |= FLAG_RATES;
 
     // Channel 7
-    if (Channels[CHANNEL7] <= 0)
+    if (p->channels[CHANNEL7] <= 0)
         *flags &= ~FLAG_PICTURE;
     else
         *flags |= FLAG_PICTURE;
 
     // Channel 8
-    if (Channels[CHANNEL8] <= 0)
+    if (p->channels[CHANNEL8] <= 0)
         *flags &= ~FLAG_VIDEO;
     else
         *flags |= FLAG_VIDEO;
@@ -144,8 +131,10 @@ static void read_controls(uint8* throttle, uint8* rudder, uint8* elevator, uint8
 
 #define X5C_CHAN2TRIM(X) ((((X) & 0x80 ? 0xff - (X) : 0x80 + (X)) >> 2) + 0x20)
 
-static void build_packet_x5c(uint8 bind)
+static void build_packet_x5c(proto_instance *p, uint8 bind)
 {
+    uint8 *packet = p->packet;
+
     if (bind) {
         memset(packet, 0, packet_size);
         packet[7] = 0xae;
@@ -153,7 +142,7 @@ static void build_packet_x5c(uint8 bind)
         packet[14] = 0xc0;
         packet[15] = 0x17;
     } else {
-        read_controls(&throttle, &rudder, &elevator, &aileron, &flags);
+        read_controls(p, &throttle, &rudder, &elevator, &aileron, &flags);
 
         packet[0] = throttle;
         packet[1] = rudder;
@@ -178,7 +167,9 @@ static void build_packet_x5c(uint8 bind)
 }
 
 
-static void build_packet(uint8 bind) {
+static void build_packet(proto_instance *p, uint8 bind) {
+    uint8 *packet = p->packet;
+
     if (bind) {
         packet[0] = rx_tx_addr[4];
         packet[1] = rx_tx_addr[3];
@@ -190,7 +181,7 @@ static void build_packet(uint8 bind) {
         packet[7] = 0xaa;
         packet[8] = 0x00;
     } else {
-        read_controls(&throttle, &rudder, &elevator, &aileron, &flags);
+        read_controls(p, &throttle, &rudder, &elevator, &aileron, &flags);
 
         packet[0] = throttle;
         packet[1] = elevator;
@@ -209,27 +200,41 @@ static void build_packet(uint8 bind) {
 }
 
 
-void symax_send_packet(uint8 bind)
+static uint8 symax_build(proto_instance *p, uint8 bind)
 {
     if (PROTOOPTS_X5C)
-        build_packet_x5c(bind);
+        build_packet_x5c(p, bind);
     else
-        build_packet(bind);
+        build_packet(p, bind);
+    return packet_size;
+}
+
+static uint8 symax_build_bind(proto_instance *p)
+{
+    return symax_build(p, 1);
+}
+
+static uint8 symax_build_data(proto_instance *p)
+{
+    return symax_build(p, 0);
+}
 
+static void symax_send(proto_instance *p, uint8 len)
+{
     // clear packet status bits and TX FIFO
     NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
     NRF24L01_WriteReg(NRF24L01_00_CONFIG, 0x2e);
     NRF24L01_WriteReg(NRF24L01_05_RF_CH, chans[current_chan]);
     NRF24L01_FlushTx();
 
-    NRF24L01_WritePayload(packet, packet_size);
+    NRF24L01_WritePayload(p->packet, len);
 
     if (packet_counter++ % 2) {   // use each channel twice
         current_chan = (current_chan + 1) % num_rf_channels;
     }
 }
 
-static void symax_init1()
+static void symax_init1(proto_instance *p)
 {
     // write a strange first packet to RF channel 8 ...
     uint8 first_packet[] = {0xf9, 0x96, 0x82, 0x1b, 0x20, 0x08, 0x08, 0xf2, 0x7d, 0xef, 0xff, 0x00, 0x00, 0x00, 0x00};
@@ -239,6 +244,7 @@ static void symax_init1()
 
 //    uint8 data_rx_tx_addr[] = {0x3b,0xb6,0x00,0x00,0xa2};
 
+    (void)p;
     NRF24L01_FlushTx();
     NRF24L01_WriteReg(NRF24L01_05_RF_CH, 0x08);
     NRF24L01_WritePayload(first_packet, 15);
@@ -255,48 +261,62 @@ static void symax_init1()
     packet_counter = 0;
 }
 
-void symax_set_channels(uint8 address) {
-  static const uint8 start_chans_1[] = {0x0a, 0x1a, 0x2a, 0x3a};
-  static const uint8 start_chans_2[] = {0x2a, 0x0a, 0x42, 0x22};
-  static const uint8 start_chans_3[] = {0x1a, 0x3a, 0x12, 0x32};
-
-  uint8 laddress = address & 0x1f;
-  uint8 i;
-
-  num_rf_channels = sizeof(start_chans_1);
-  if (laddress < 0x10) {
-    if (laddress == 6) laddress = 7;
-    for(i=0; i < sizeof(start_chans_1); i++) {
-      chans[i] = start_chans_1[i] + laddress;
-    }
-  } else if (laddress < 0x18) {
-    for(i=0; i < sizeof(start_chans_2); i++) {
-      chans[i] = start_chans_2[i] + (laddress & 0x07);
-    }
-    if (laddress == 0x16) {
-      chans[0] += 1;
-      chans[1] += 1;
-    }
-  } else if (laddress < 0x1e) {
-    for(i=0; i < sizeof(start_chans_3); i++) {
-      chans[i] = start_chans_3[i] + (laddress & 0x07);
-    }
-  } else if (laddress == 0x1e)
-      *(uint32*)chans = 0x38184121;
-    else
-      *(uint32*)chans = 0x39194121;
+// Data phase hop channels indexed by low five bits of address.
+// Generated from the stock tx rules: base 0x0a/0x1a/0x2a/0x3a + address
+// below 0x10 (6 uses 7), base 0x2a/0x0a/0x42/0x22 + (address & 7) below
+// 0x18 (0x16 bumps the first two), base 0x1a/0x3a/0x12/0x32 + (address & 7)
+// below 0x1e, and fixed sets for 0x1e and 0x1f.
+static const uint8 symax_hop_table[32][NUM_X11_CHANNELS] = {
+  {0x0a, 0x1a, 0x2a, 0x3a},   // 0x00
+  {0x0b, 0x1b, 0x2b, 0x3b},   // 0x01
+  {0x0c, 0x1c, 0x2c, 0x3c},   // 0x02
+  {0x0d, 0x1d, 0x2d, 0x3d},   // 0x03
+  {0x0e, 0x1e, 0x2e, 0x3e},   // 0x04
+  {0x0f, 0x1f, 0x2f, 0x3f},   // 0x05
+  {0x11, 0x21, 0x31, 0x41},   // 0x06
+  {0x11, 0x21, 0x31, 0x41},   // 0x07
+  {0x12, 0x22, 0x32, 0x42},   // 0x08
+  {0x13, 0x23, 0x33, 0x43},   // 0x09
+  {0x14, 0x24, 0x34, 0x44},   // 0x0a
+  {0x15, 0x25, 0x35, 0x45},   // 0x0b
+  {0x16, 0x26, 0x36, 0x46},   // 0x0c
+  {0x17, 0x27, 0x37, 0x47},   // 0x0d
+  {0x18, 0x28, 0x38, 0x48},   // 0x0e
+  {0x19, 0x29, 0x39, 0x49},   // 0x0f
+  {0x2a, 0x0a, 0x42, 0x22},   // 0x10
+  {0x2b, 0x0b, 0x43, 0x23},   // 0x11
+  {0x2c, 0x0c, 0x44, 0x24},   // 0x12
+  {0x2d, 0x0d, 0x45, 0x25},   // 0x13
+  {0x2e, 0x0e, 0x46, 0x26},   // 0x14
+  {0x2f, 0x0f, 0x47, 0x27},   // 0x15
+  {0x31, 0x11, 0x48, 0x28},   // 0x16
+  {0x31, 0x11, 0x49, 0x29},   // 0x17
+  {0x1a, 0x3a, 0x12, 0x32},   // 0x18
+  {0x1b, 0x3b, 0x13, 0x33},   // 0x19
+  {0x1c, 0x3c, 0x14, 0x34},   // 0x1a
+  {0x1d, 0x3d, 0x15, 0x35},   // 0x1b
+  {0x1e, 0x3e, 0x16, 0x36},   // 0x1c
+  {0x1f, 0x3f, 0x17, 0x37},   // 0x1d
+  {0x21, 0x41, 0x18, 0x38},   // 0x1e
+  {0x21, 0x41, 0x19, 0x39},   // 0x1f
+};
+
+const uint8 *symax_hop_channels(uint8 address) {
+  return symax_hop_table[address & 0x1f];
+}
 
-char outbuf[64];
-snprintf(outbuf, sizeof(outbuf), "lb:%02X, ch:%02X%02X%02X%02X\r\n", address, chans[0], chans[1], chans[2], chans[3]);
-USB_serial_UartPutString(outbuf);
+void symax_set_channels(uint8 address) {
+  num_rf_channels = NUM_X11_CHANNELS;
+  memcpy(chans, symax_hop_channels(address), NUM_X11_CHANNELS);
 }
 
-static void symax_init2()
+static void symax_init2(proto_instance *p)
 {
 //    uint8 chans_data[] = {0x1d, 0x3d, 0x15, 0x35};
     uint8 chans_data_x5c[] = {0x1d, 0x2f, 0x26, 0x3d, 0x15, 0x2b, 0x25, 0x24,
                            0x27, 0x2c, 0x1c, 0x3e, 0x39, 0x2d, 0x22};
 
+    (void)p;
     if (PROTOOPTS_X5C) {
       num_rf_channels = sizeof(chans_data_x5c);
       memcpy(chans, chans_data_x5c, num_rf_channels);
@@ -311,11 +331,11 @@ static void symax_init2()
     packet_counter = 0;
 }
 
-void symax_init(uint8 tx_addr[]) {
-  const uint8 bind_rx_tx_addr[] = {0xab,0xac,0xad,0xae,0xaf};
-  const uint8 bind_rx_tx_addr_x5c[] = {0x6d,0x6a,0x73,0x73,0x73};
-  
-  symax_phase = SYMAX_INIT1;
+static const uint8 bind_rx_tx_addr[] = {0xab,0xac,0xad,0xae,0xaf};
+static const uint8 bind_rx_tx_addr_x5c[] = {0x6d,0x6a,0x73,0x73,0x73};
+
+static void symax_init(proto_instance *p, uint8 tx_addr[]) {
+  (void)p;
   packet_counter = 0;
   flags = 0;
   memcpy(rx_tx_addr, tx_addr, sizeof(rx_tx_addr));  
@@ -405,37 +425,41 @@ void symax_init(uint8 tx_addr[]) {
 }
 
 
-uint16 symax_callback(volatile int32 channels[])
+// Eleven bind packets after the first packet delay, then data forever.
+// Phase order must match SYMAX_INIT1/SYMAX_BIND/SYMAX_DATA in protocols.h.
+static const proto_phase symax_phases[] = {
+    [SYMAX_INIT1] = { .enter = symax_init1, .period = FIRST_PACKET_DELAY,
+                      .repeat = 1, .next_phase = SYMAX_BIND },
+    [SYMAX_BIND]  = { .build = symax_build_bind,
+                      .repeat = BIND_COUNT + 1, .next_phase = SYMAX_DATA },
+    [SYMAX_DATA]  = { .enter = symax_init2, .build = symax_build_data,
+                      .next_phase = PROTO_STAY },
+};
+
+// Radio setup that differs from other protocols, restored when sharing the
+// radio.  Send rewrites CONFIG and the channel every packet.
+static void symax_resume(proto_instance *p)
 {
-    memcpy(Channels, (const void *)channels, sizeof(Channels));
-    
-    switch (symax_phase) {
-    case SYMAX_INIT1:
-        symax_init1();
-        symax_phase = SYMAX_BIND2;
-        return FIRST_PACKET_DELAY;
-        break;
-
-    case SYMAX_BIND2:
-        counter = BIND_COUNT;
-        symax_phase = SYMAX_BIND3;
-        symax_send_packet(1);
-        break;
-
-    case SYMAX_BIND3:
-        if (counter == 0) {
-            symax_init2();
-            symax_phase = SYMAX_DATA;
-        } else {
-            symax_send_packet(1);
-            counter -= 1;
-        }
-        break;
-
-    case SYMAX_DATA:
-        symax_send_packet(0);
-        break;
-    }
-    return PACKET_PERIOD;
+    NRF24L01_WriteReg(NRF24L01_01_EN_AA, 0x00);      // No Auto Acknoledgement
+    NRF24L01_WriteReg(NRF24L01_03_SETUP_AW, 0x03);   // 5-byte RX/TX address
+    NRF24L01_WriteReg(NRF24L01_1C_DYNPD, 0x00);
+    NRF24L01_WriteReg(NRF24L01_1D_FEATURE, 0x00);
+    NRF24L01_SetBitrate(PROTOOPTS_X5C ? NRF24L01_BR_1M : NRF24L01_BR_250K);
+    NRF24L01_SetPower(TXPOWER_150mW);
+    if (p->phase == SYMAX_DATA)
+        NRF24L01_WriteRegisterMulti(NRF24L01_10_TX_ADDR, rx_tx_addr, 5);
+    else
+        NRF24L01_WriteRegisterMulti(NRF24L01_10_TX_ADDR,
+                                    PROTOOPTS_X5C ? bind_rx_tx_addr_x5c : bind_rx_tx_addr,
+                                    5);
 }
 
+const proto_desc symax_desc = {
+    .name = "SymaX",
+    .init = symax_init,
+    .send = symax_send,
+    .resume = symax_resume,
+    .phases = symax_phases,
+    .num_phases = sizeof(symax_phases) / sizeof(symax_phases[0]),
+    .period = PACKET_PERIOD,
+};
@@ -0,0 +1,123 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// SymaX (X11, X12 and compatible) receiver.  Bind packets carry the data
+// address; its first byte picks the hop channels as in symax_proto.c.
+
+#include <project.h>
+#include "nrf24l01.h"
+#include "protocols.h"
+#include "proto_rx.h"
+
+#define PACKET_SIZE     10
+#define PACKET_PERIOD 4000          // us
+#define HOP_PACKETS      2          // each channel is used twice
+
+enum {
+    CHANNEL1 = 0,   // Aileron
+    CHANNEL2,       // Elevator
+    CHANNEL3,       // Throttle
+    CHANNEL4,       // Rudder
+    CHANNEL5,       // Flip
+    CHANNEL6,       // Rates
+    CHANNEL7,       // Picture
+    CHANNEL8,       // Video
+};
+
+static const uint8 bind_addr[] = {0xab,0xac,0xad,0xae,0xaf};
+static const uint8 bind_chans[] = {0x4b, 0x30, 0x40, 0x2e};
+
+static uint8 checksum(const uint8 *data)
+{
+    uint8 sum = data[0];
+    uint8 i;
+
+    for (i = 1; i < PACKET_SIZE - 1; i++)
+        sum ^= data[i];
+    return sum + 0x55;
+}
+
+// Sign + magnitude 8bit value to channel
+static int32 convert_channel(uint8 b)
+{
+    int32 ch = (b & 0x7f) * CHAN_MAX_VALUE / 127;
+    return b & 0x80 ? -ch : ch;
+}
+
+static int32 flag(uint8 set)
+{
+    return set ? CHAN_MAX_VALUE : CHAN_MIN_VALUE;
+}
+
+static void symax_rx_init(void)
+{
+    NRF24L01_Initialize();
+    NRF24L01_WriteReg(NRF24L01_01_EN_AA, 0x00);      // No Auto Acknowledgement
+    NRF24L01_WriteReg(NRF24L01_02_EN_RXADDR, 0x01);  // Pipe 0 only
+    NRF24L01_WriteReg(NRF24L01_03_SETUP_AW, 0x03);   // 5-byte RX/TX address
+    NRF24L01_WriteReg(NRF24L01_11_RX_PW_P0, PACKET_SIZE);
+    NRF24L01_WriteReg(NRF24L01_1C_DYNPD, 0x00);
+    NRF24L01_WriteReg(NRF24L01_1D_FEATURE, 0x00);
+    NRF24L01_SetBitrate(NRF24L01_BR_250K);
+    NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, bind_addr, 5);
+    NRF24L01_SetTxRxMode(RX_EN);                     // 2 byte CRC, PRIM_RX
+    proto_rx_set_hops(bind_chans, sizeof(bind_chans), HOP_PACKETS, PACKET_PERIOD);
+}
+
+static uint8 symax_rx_read(uint8 packet[])
+{
+    NRF24L01_ReadPayload(packet, PACKET_SIZE);
+    return PACKET_SIZE;
+}
+
+static uint8 symax_rx_decode(const uint8 packet[], uint8 len, volatile int32 channels[])
+{
+    uint8 t = packet[0];
+
+    if (len != PACKET_SIZE || checksum(packet) != packet[9])
+        return PROTO_RX_BAD;
+    if (packet[5] == 0xaa && packet[6] == 0xaa && packet[7] == 0xaa)
+        return PROTO_RX_BIND;
+
+    channels[CHANNEL1] = convert_channel(packet[3]);
+    channels[CHANNEL2] = convert_channel(packet[1]);
+    // throttle is offset binary rather than sign + magnitude
+    channels[CHANNEL3] = (t & 0x80 ? t - 0x80 : -(0x7f - t)) * CHAN_MAX_VALUE / 127;
+    channels[CHANNEL4] = convert_channel(packet[2]);
+    channels[CHANNEL5] = flag(packet[6] & 0x40);
+    channels[CHANNEL6] = flag(packet[5] & 0x80);
+    channels[CHANNEL7] = flag(packet[4] & 0x40);
+    channels[CHANNEL8] = flag(packet[4] & 0x80);
+    return PROTO_RX_DATA;
+}
+
+// Bind packets carry the address last byte first
+static void symax_rx_bind(const uint8 packet[])
+{
+    uint8 addr[5];
+    uint8 i;
+
+    for (i = 0; i < 5; i++)
+        addr[i] = packet[4 - i];
+    NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, addr, 5);
+    proto_rx_set_hops(symax_hop_channels(addr[0]), 4, HOP_PACKETS, PACKET_PERIOD);
+}
+
+const proto_rx_desc symax_rx_desc = {
+    .name = "SymaX",
+    .init = symax_rx_init,
+    .read = symax_rx_read,
+    .decode = symax_rx_decode,
+    .bind = symax_rx_bind,
+};
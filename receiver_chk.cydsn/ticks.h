@@ -0,0 +1,61 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _TICKS_H_
+#define _TICKS_H_
+
+// 16-bit capture timer ticks to microseconds without a divide, the same
+// file in receiver_chk and protocol_chk.  The Cortex-M0 has no divider,
+// so "/ 3" is a libgcc call; this is one multiply and a shift with
+// constants the compiler folds from the timer clock.  timebase.c uses
+// it the same way for SysTick cycles within one tick.
+//
+// The multiplier is 2^shift / (ticks per us) rounded up, with the shift
+// as large as keeps 65535 * multiplier within 32 bits.  That gives exact
+// division over the whole 16-bit range for the clocks the projects use,
+// checked on a host by host/ticks_check.c.  Whole MHz clocks only.
+//
+// Not every clock is exact (7MHz is not), so TICKS_TO_US() refuses to
+// compile for one that is not.  Rounding the multiplier up adds err / 2^shift
+// per tick, the remainder leaves at most 1 - 1/(ticks per us) before the
+// quotient steps, so 65535 * err < 2^shift is enough to be exact.
+//
+// No hardware dependencies, builds on a host with -DEMULATOR.
+#ifdef EMULATOR
+#include <stdint.h>
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+#else
+#include <project.h>
+#endif
+
+#define TICKS_PER_US(hz)    ((hz) / 1000000UL)
+#define TICKS_LOG2(n)       ((n) >= 32 ? 5 : (n) >= 16 ? 4 : (n) >= 8 ? 3 : (n) >= 4 ? 2 : (n) >= 2 ? 1 : 0)
+#define TICKS_SHIFT(hz)     (16 + TICKS_LOG2(TICKS_PER_US(hz)))
+#define TICKS_MUL(hz)       (((1UL << TICKS_SHIFT(hz)) + TICKS_PER_US(hz) - 1) / TICKS_PER_US(hz))
+#define TICKS_ERR(hz)       (TICKS_MUL(hz) * TICKS_PER_US(hz) - (1UL << TICKS_SHIFT(hz)))
+#define TICKS_EXACT(hz)     (0xffffUL * TICKS_ERR(hz) < (1UL << TICKS_SHIFT(hz)))
+
+// ticks is a 16-bit count, from ticks_since().  An inexact clock is a
+// negative array size.
+#define TICKS_TO_US(ticks, hz) \
+    ((void)sizeof(char[TICKS_EXACT(hz) ? 1 : -1]), \
+     ((uint32)(uint16)(ticks) * TICKS_MUL(hz)) >> TICKS_SHIFT(hz))
+
+// Counts from then to now on a 16-bit timer, correct across the wrap
+static inline uint16 ticks_since(uint32 now, uint32 then)
+{
+    return (uint16)(now - then);
+}
+
+#endif
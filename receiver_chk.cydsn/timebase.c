@@ -0,0 +1,57 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timebase.h"
+#include "ticks.h"
+
+#define ICSR_PENDSTSET  (1UL << 26)     // SysTick exception pending
+
+static uint32 tick_cycles;
+static uint32 tick_us;
+static volatile uint32 timebase_base;   // us at the last SysTick reload
+
+static void timebase_tick(void)
+{
+    timebase_base += tick_us;
+}
+
+// Shares the idle wake tick: slot 0 is idle's callback, this takes slot 1
+void timebase_start(void)
+{
+    tick_cycles = CySysTickGetReload() + 1;
+    tick_us = tick_cycles / CYDEV_BCLK__SYSCLK__MHZ;
+    CySysTickSetCallback(1, timebase_tick);
+}
+
+uint32 timebase_us(void)
+{
+    uint32 base, value, reloaded, cycles;
+
+    // retry if the tick landed between the reads
+    do {
+        base = timebase_base;
+        value = CySysTickGetValue();
+        // reloaded but the tick not yet run, as with interrupts masked:
+        // read the counter again after the reload and count it here
+        reloaded = CY_GET_REG32(CYREG_CM0_ICSR) & ICSR_PENDSTSET;
+        if (reloaded)
+            value = CySysTickGetValue();
+    } while (base != timebase_base);
+    cycles = tick_cycles - 1 - value;
+    if (reloaded)
+        base += tick_us;
+
+    // cycles within one tick fit 16 bits, no divide
+    return base + TICKS_TO_US(cycles, CYDEV_BCLK__SYSCLK__HZ);
+}
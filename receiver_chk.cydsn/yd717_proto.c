@@ -65,30 +65,56 @@ enum {
 #define PAYLOADSIZE 8       // receive data pipes set to this size, but unused
 #define MAX_PACKET_SIZE 9   // YD717 packets have 8-byte payload, Syma X4 is 9
 
-static uint8 packet[MAX_PACKET_SIZE];
-static uint16 counter;
 static uint32 packet_counter;
 static uint8 tx_power = TXPOWER_1mW;
 static uint8 throttle, rudder, elevator, aileron, flags;
 static uint8 rudder_trim, elevator_trim, aileron_trim;
 static uint8 rx_tx_addr[5];
-static int32 Channels[8];   // simulate Deviation channels
+static uint8 last_ack;
 
 
 enum {
     YD717_INIT1 = 0,
     YD717_BIND2,
+    YD717_BIND_DONE,
     YD717_BIND3,
     YD717_DATA
 };
-static uint8 phase = YD717_INIT1;
 
 #define FORMAT_YD717   0
 #define FORMAT_SKYWLKR 1
 #define FORMAT_XINXUN  2
 #define FORMAT_NI_HUI  3
 #define FORMAT_SYMAX2  4
-#define PROTOOPTS_FORMAT  FORMAT_YD717
+
+// Per-format packet layout, selected at init from the engine format index
+typedef struct {
+    uint8 bind_addr;        // repeated for all 5 bind address bytes
+    uint8 bind_byte6;       // packet[6] of bind packets
+    uint8 rudder_xor;       // 0xff reverses rudder stick, trim is unaffected
+    uint8 rudder_trim_idx;  // packet positions of the trims
+    uint8 elevator_trim_idx;
+    uint8 aileron_trim_idx;
+    uint8 payload_len;      // 9 appends a checksum byte
+} yd717_format;
+
+static const yd717_format yd717_formats[] = {
+    [FORMAT_YD717]   = { 0x65, 0x32, 0x00, 6, 2, 5, 8 },
+    [FORMAT_SKYWLKR] = { 0x65, 0x32, 0x00, 2, 5, 6, 9 },
+    [FORMAT_XINXUN]  = { 0x65, 0x32, 0xff, 2, 5, 6, 9 },
+    [FORMAT_NI_HUI]  = { 0x64, 0x00, 0x00, 2, 5, 6, 9 },
+    [FORMAT_SYMAX2]  = { 0x60, 0x32, 0x00, 2, 5, 6, 9 },
+};
+
+static const char * const yd717_format_names[] = {
+    [FORMAT_YD717]   = "YD717",
+    [FORMAT_SKYWLKR] = "Skywalker",
+    [FORMAT_XINXUN]  = "XinXun",
+    [FORMAT_NI_HUI]  = "Ni Hui",
+    [FORMAT_SYMAX2]  = "SymaX2",
+};
+
+static const yd717_format *fmt = &yd717_formats[FORMAT_YD717];
 
 
 #ifdef YD717_TELEMETRY
@@ -119,9 +145,9 @@ static uint8 packet_ack()
 }
 
 
-static uint8 convert_channel(uint8 num)
+static uint8 convert_channel(proto_instance *p, uint8 num)
 {
-    int32 ch = Channels[num];
+    int32 ch = p->channels[num];
     if (ch < CHAN_MIN_VALUE) {
         ch = CHAN_MIN_VALUE;
     } else if (ch > CHAN_MAX_VALUE) {
@@ -133,48 +159,46 @@ static uint8 convert_channel(uint8 num)
 
 
 
-static void read_controls(uint8* throttle, uint8* rudder, uint8* elevator, uint8* aileron,
+static void read_controls(proto_instance *p, uint8* throttle, uint8* rudder, uint8* elevator, uint8* aileron,
                           uint8* flags, uint8* rudder_trim, uint8* elevator_trim, uint8* aileron_trim)
 {
     // Protocol is registered AETRF, that is
     // Aileron is channel 1, Elevator - 2, Throttle - 3, Rudder - 4, Flip control - 5
 
     // Channel 3
-    *throttle = convert_channel(CHANNEL3);
+    *throttle = convert_channel(p, CHANNEL3);
 
     // Channel 4
-    if(PROTOOPTS_FORMAT == FORMAT_XINXUN) {
-      *rudder = convert_channel(CHANNEL4);
-      *rudder_trim = (0xff - *rudder) >> 1;
-    } else {
-      *rudder = 0xff - convert_channel(CHANNEL4);
-      *rudder_trim = *rudder >> 1;
-    }
+    *rudder_trim = 0xff - convert_channel(p, CHANNEL4);
+    *rudder = *rudder_trim ^ fmt->rudder_xor;
+    *rudder_trim >>= 1;
 
     // Channel 2
-    *elevator = convert_channel(CHANNEL2);
+    *elevator = convert_channel(p, CHANNEL2);
     *elevator_trim = *elevator >> 1;
 
     // Channel 1
-    *aileron = 0xff - convert_channel(CHANNEL1);
+    *aileron = 0xff - convert_channel(p, CHANNEL1);
     *aileron_trim = *aileron >> 1;
 
     // Channel 5
-    if (Channels[CHANNEL5] <= 0)
+    if (p->channels[CHANNEL5] <= 0)
       *flags &= ~FLAG_FLIP;
     else
       *flags |= FLAG_FLIP;
 
     // Channel 6
-    if (Channels[CHANNEL6] <= 0)
+    if (p->channels[CHANNEL6] <= 0)
       *flags &= ~FLAG_LIGHT;
     else
       *flags |= FLAG_LIGHT;
 }
 
 
-static void send_packet(uint8 bind)
+static uint8 build_packet(proto_instance *p, uint8 bind)
 {
+    uint8 *packet = p->packet;
+
     if (bind) {
         packet[0]= rx_tx_addr[0]; // send data phase address in first 4 bytes
         packet[1]= rx_tx_addr[1];
@@ -182,41 +206,47 @@ static void send_packet(uint8 bind)
         packet[3]= rx_tx_addr[3];
         packet[4] = 0x56;
         packet[5] = 0xAA;
-        packet[6] = PROTOOPTS_FORMAT == FORMAT_NI_HUI ? 0x00 : 0x32;
+        packet[6] = fmt->bind_byte6;
         packet[7] = 0x00;
     } else {
-        read_controls(&throttle, &rudder, &elevator, &aileron, &flags, &rudder_trim, &elevator_trim, &aileron_trim);
+        read_controls(p, &throttle, &rudder, &elevator, &aileron, &flags, &rudder_trim, &elevator_trim, &aileron_trim);
         packet[0] = throttle;
         packet[1] = rudder;
         packet[3] = elevator;
         packet[4] = aileron;
-        if(PROTOOPTS_FORMAT == FORMAT_YD717) {
-            packet[2] = elevator_trim;
-            packet[5] = aileron_trim;
-            packet[6] = rudder_trim;
-        } else {
-            packet[2] = rudder_trim;
-            packet[5] = elevator_trim;
-            packet[6] = aileron_trim;
-        }
+        packet[fmt->rudder_trim_idx]   = rudder_trim;
+        packet[fmt->elevator_trim_idx] = elevator_trim;
+        packet[fmt->aileron_trim_idx]  = aileron_trim;
         packet[7] = flags;
     }
 
+    if (fmt->payload_len == 8)
+        return 8;
+
+    packet[8] = packet[0];  // checksum
+    uint8 i;
+    for(i=1; i < 8; i++) packet[8] += packet[i];
+    packet[8] = ~packet[8];
+    return 9;
+}
 
+static uint8 yd717_build_bind(proto_instance *p)
+{
+    return build_packet(p, 1);
+}
+
+static uint8 yd717_build_data(proto_instance *p)
+{
+    return build_packet(p, 0);
+}
+
+static void yd717_send(proto_instance *p, uint8 len)
+{
     // clear packet status bits and TX FIFO
     NRF24L01_WriteReg(NRF24L01_07_STATUS, (BV(NRF24L01_07_TX_DS) | BV(NRF24L01_07_MAX_RT)));
     NRF24L01_FlushTx();
 
-    if(PROTOOPTS_FORMAT == FORMAT_YD717) {
-        NRF24L01_WritePayload(packet, 8);
-    } else {
-        packet[8] = packet[0];  // checksum
-        uint8 i;
-        for(i=1; i < 8; i++) packet[8] += packet[i];
-        packet[8] = ~packet[8];
-
-        NRF24L01_WritePayload(packet, 9);
-    }
+    NRF24L01_WritePayload(p->packet, len);
 
     ++packet_counter;
 
@@ -251,31 +281,31 @@ static void initialize_rx_tx_addr()
 }
 
 
-static void YD717_init1()
+static void YD717_init1(proto_instance *p)
 {
     // for bind packets set address to prearranged value known to receiver
-    uint8 bind_rx_tx_addr[] = {0x65, 0x65, 0x65, 0x65, 0x65};
-    uint8 i;
-    if (PROTOOPTS_FORMAT == FORMAT_SYMAX2)
-        for(i=0; i < 5; i++) bind_rx_tx_addr[i]  = 0x60;
-    else if (PROTOOPTS_FORMAT == FORMAT_NI_HUI)
-        for(i=0; i < 5; i++) bind_rx_tx_addr[i]  = 0x64;
+    uint8 bind_rx_tx_addr[5];
+
+    (void)p;
+    memset(bind_rx_tx_addr, fmt->bind_addr, sizeof(bind_rx_tx_addr));
 
     NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, bind_rx_tx_addr, 5);
     NRF24L01_WriteRegisterMulti(NRF24L01_10_TX_ADDR, bind_rx_tx_addr, 5);
 }
 
 
-static void YD717_init2()
+static void YD717_init2(proto_instance *p)
 {
+    (void)p;
     // set rx/tx address for data phase
     NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, rx_tx_addr, 5);
     NRF24L01_WriteRegisterMulti(NRF24L01_10_TX_ADDR, rx_tx_addr, 5);
 }
 
-void yd717_init(uint8 unused[])
+static void yd717_init(proto_instance *p, uint8 unused[])
 {
     (void)unused;
+    fmt = &yd717_formats[p->format];
     packet_counter = 0;
     flags = 0;
     initialize_rx_tx_addr();
@@ -370,72 +400,86 @@ static void update_telemetry() {
 #endif
 
 
+// Hold off until the previous packet is acknowledged or timed out
+static uint16 yd717_wait_ack(proto_instance *p)
+{
+    (void)p;
+    last_ack = packet_ack();
+    if (last_ack == PKT_PENDING)
+        return PACKET_CHKTIME;             // packet send not yet complete
+    return 0;
+}
 
-uint16 yd717_callback(volatile int32 channels[])
+static uint16 yd717_wait_data(proto_instance *p)
 {
-  memcpy(Channels, (const void *)channels, sizeof(Channels));
-        
-    switch (phase) {
-    case YD717_INIT1:
-        send_packet(0);      // receiver doesn't re-enter bind mode if connection lost...check if already bound
-        phase = YD717_BIND3;
-//        USB_serial_UartPutString("YD717_INIT1\r\n");
-        break;
-
-    case YD717_BIND2:
-        if (counter == 0) {
-            if (packet_ack() == PKT_PENDING)
-                return PACKET_CHKTIME;             // packet send not yet complete
-//            USB_serial_UartPutString("YD717_BIND2=0\r\n");
-            YD717_init2();                         // change to data phase rx/tx address
-            send_packet(0);
-            phase = YD717_BIND3;
-        } else {
-            if (packet_ack() == PKT_PENDING)
-                return PACKET_CHKTIME;             // packet send not yet complete
-            send_packet(1);
-            counter -= 1;
-        }
-        break;
-
-    case YD717_BIND3:
-        switch (packet_ack()) {
-        case PKT_PENDING:
-//            USB_serial_UartPutString("YD717_BIND3_P\r\n");
-            return PACKET_CHKTIME;                 // packet send not yet complete
-        case PKT_ACKED:
-//            USB_serial_UartPutString("YD717_BIND3\r\n");
-            phase = YD717_DATA;
-            break;
-        case PKT_TIMEOUT:
-//            USB_serial_UartPutString("YD717_BIND3_T\r\n");
-            YD717_init1();                         // change to bind rx/tx address
-            counter = BIND_COUNT;
-            phase = YD717_BIND2;
-            send_packet(1);
-        }
-        break;
-
-    case YD717_DATA:
 #ifdef YD717_TELEMETRY
-        update_telemetry();
+    update_telemetry();
 #endif
-        if (packet_ack() == PKT_PENDING)
-            return PACKET_CHKTIME;                 // packet send not yet complete
 #if 0  // unimplemented channel hopping for Ni Hui quad
-        else if (packet_ack() == PKT_TIMEOUT && Model.proto_opts[PROTOOPTS_FORMAT] == FORMAT_NI_HUI) {
-            // Sequence (after default channel 0x3C) is channels 0x02, 0x21 (at least for TX Addr is 87 04 14 00)
-        }
-#endif
-
-        send_packet(0);
-        break;
+    if (packet_ack() == PKT_TIMEOUT && fmt == &yd717_formats[FORMAT_NI_HUI]) {
+        // Sequence (after default channel 0x3C) is channels 0x02, 0x21 (at least for TX Addr is 87 04 14 00)
     }
-    return PACKET_PERIOD;                          // Packet every 8ms
+#endif
+    return yd717_wait_ack(p);
 }
 
+// Bound receivers ack the data packet, otherwise rebind
+static uint8 yd717_next_bind3(proto_instance *p)
+{
+    (void)p;
+    return last_ack == PKT_ACKED ? YD717_DATA : YD717_BIND2;
+}
 
+// receiver doesn't re-enter bind mode if connection lost, so INIT1
+// first sends a data packet to check if already bound
+static const proto_phase yd717_phases[] = {
+    [YD717_INIT1]     = { .build = yd717_build_data,
+                          .repeat = 1, .next_phase = YD717_BIND3 },
+    [YD717_BIND2]     = { .enter = YD717_init1, .wait = yd717_wait_ack,
+                          .build = yd717_build_bind,
+                          .repeat = BIND_COUNT + 1, .next_phase = YD717_BIND_DONE },
+    [YD717_BIND_DONE] = { .enter = YD717_init2, .wait = yd717_wait_ack,
+                          .build = yd717_build_data,
+                          .repeat = 1, .next_phase = YD717_BIND3 },
+    [YD717_BIND3]     = { .wait = yd717_wait_ack,
+                          .repeat = 1, .next = yd717_next_bind3 },
+    [YD717_DATA]      = { .wait = yd717_wait_data, .build = yd717_build_data,
+                          .next_phase = PROTO_STAY },
+};
 
+// Radio setup that differs from other protocols, restored when sharing the
+// radio.  YD717 waits for auto-ack so it works best with long periods.
+static void yd717_resume(proto_instance *p)
+{
+    uint8 bind_rx_tx_addr[5];
 
+    NRF24L01_WriteReg(NRF24L01_00_CONFIG, BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_PWR_UP)); 
+    NRF24L01_WriteReg(NRF24L01_01_EN_AA, 0x3F);      // Auto Acknoledgement on all data pipes
+    NRF24L01_WriteReg(NRF24L01_03_SETUP_AW, 0x03);   // 5-byte RX/TX address
+    NRF24L01_WriteReg(NRF24L01_04_SETUP_RETR, 0x1A); // 500uS retransmit t/o, 10 tries
+    NRF24L01_WriteReg(NRF24L01_05_RF_CH, RF_CHANNEL);
+    NRF24L01_SetBitrate(NRF24L01_BR_1M);
+    NRF24L01_SetPower(tx_power);
+    NRF24L01_WriteReg(NRF24L01_1C_DYNPD, 0x3F);
+    NRF24L01_WriteReg(NRF24L01_1D_FEATURE, 0x07);
+    if (p->phase == YD717_BIND2 && p->entered) {
+        memset(bind_rx_tx_addr, fmt->bind_addr, sizeof(bind_rx_tx_addr));
+        NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, bind_rx_tx_addr, 5);
+        NRF24L01_WriteRegisterMulti(NRF24L01_10_TX_ADDR, bind_rx_tx_addr, 5);
+    } else {
+        NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, rx_tx_addr, 5);
+        NRF24L01_WriteRegisterMulti(NRF24L01_10_TX_ADDR, rx_tx_addr, 5);
+    }
+}
 
-
+const proto_desc yd717_desc = {
+    .name = "YD717",
+    .init = yd717_init,
+    .send = yd717_send,
+    .resume = yd717_resume,
+    .phases = yd717_phases,
+    .num_phases = sizeof(yd717_phases) / sizeof(yd717_phases[0]),
+    .period = PACKET_PERIOD,                   // Packet every 8ms
+    .formats = yd717_format_names,
+    .num_formats = sizeof(yd717_format_names) / sizeof(yd717_format_names[0]),
+};
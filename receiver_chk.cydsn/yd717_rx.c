@@ -0,0 +1,126 @@
+/*
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Deviation is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    see <http://www.gnu.org/licenses/>.
+*/
+
+// YD717 receiver on the fixed channel.  The transmitter waits for auto-ack
+// of every packet, so pipe 0 acks.  8 byte (YD717) and 9 byte checksummed
+// (Skywalker and later) payloads are both accepted.
+
+#include <project.h>
+#include <string.h>
+#include "nrf24l01.h"
+#include "protocols.h"
+#include "proto_rx.h"
+
+#define PACKET_PERIOD 8000          // us
+#define RF_CHANNEL    0x3C
+#define BIND_ADDR     0x65          // YD717, Skywalker and XinXun formats
+
+#define FLAG_FLIP     0x0F
+#define FLAG_LIGHT    0x10
+
+enum {
+    CHANNEL1 = 0,   // Aileron
+    CHANNEL2,       // Elevator
+    CHANNEL3,       // Throttle
+    CHANNEL4,       // Rudder
+    CHANNEL5,       // Flip
+    CHANNEL6,       // Light
+};
+
+static const uint8 rf_channel = RF_CHANNEL;
+
+// 0..255 with 0x80 in the middle to channel
+static int32 convert_channel(uint8 b)
+{
+    return ((int32)b * 2 - 0x100) * CHAN_MAX_VALUE / 0xFF;
+}
+
+static void yd717_rx_init(void)
+{
+    uint8 bind_addr[5];
+
+    memset(bind_addr, BIND_ADDR, sizeof(bind_addr));
+    NRF24L01_Initialize();
+    NRF24L01_WriteReg(NRF24L01_01_EN_AA, 0x01);      // Auto Acknowledgement on pipe 0
+    NRF24L01_WriteReg(NRF24L01_02_EN_RXADDR, 0x01);  // Pipe 0 only
+    NRF24L01_WriteReg(NRF24L01_03_SETUP_AW, 0x03);   // 5-byte RX/TX address
+    NRF24L01_SetBitrate(NRF24L01_BR_1M);             // 1Mbps
+
+    // this sequence necessary for module from stock tx
+    NRF24L01_ReadReg(NRF24L01_1D_FEATURE);
+    NRF24L01_Activate(0x73);                          // Activate feature register
+    NRF24L01_ReadReg(NRF24L01_1D_FEATURE);
+    NRF24L01_WriteReg(NRF24L01_1C_DYNPD, 0x01);       // Dynamic payload length on pipe 0
+    NRF24L01_WriteReg(NRF24L01_1D_FEATURE, 0x07);     // Set feature bits on
+
+    NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, bind_addr, 5);
+    NRF24L01_WriteReg(NRF24L01_07_STATUS, 0x70);
+    // 1 byte CRC as the transmitter, power on, RX
+    NRF24L01_WriteReg(NRF24L01_00_CONFIG, BV(NRF24L01_00_EN_CRC) | BV(NRF24L01_00_PWR_UP)
+                                        | BV(NRF24L01_00_PRIM_RX));
+    CyDelayUs(130);
+    proto_rx_set_hops(&rf_channel, 1, 1, PACKET_PERIOD);
+}
+
+static uint8 yd717_rx_read(uint8 packet[])
+{
+    uint8 len = NRF24L01_GetDynamicPayloadSize();
+
+    if (len == 0 || len > PROTO_RX_MAX_PACKET)
+        return 0;
+    NRF24L01_ReadPayload(packet, len);
+    return len;
+}
+
+static uint8 yd717_rx_decode(const uint8 packet[], uint8 len, volatile int32 channels[])
+{
+    uint8 sum = packet[0];
+    uint8 i;
+
+    if (len != 8 && len != 9)
+        return PROTO_RX_BAD;
+    if (len == 9) {
+        for (i = 1; i < 8; i++) sum += packet[i];
+        if ((uint8)~sum != packet[8])
+            return PROTO_RX_BAD;
+    }
+    if (packet[4] == 0x56 && packet[5] == 0xAA)
+        return PROTO_RX_BIND;
+
+    channels[CHANNEL1] = convert_channel(0xff - packet[4]);
+    channels[CHANNEL2] = convert_channel(packet[3]);
+    channels[CHANNEL3] = convert_channel(packet[0]);
+    channels[CHANNEL4] = convert_channel(0xff - packet[1]);
+    channels[CHANNEL5] = packet[7] & FLAG_FLIP ? CHAN_MAX_VALUE : CHAN_MIN_VALUE;
+    channels[CHANNEL6] = packet[7] & FLAG_LIGHT ? CHAN_MAX_VALUE : CHAN_MIN_VALUE;
+    return PROTO_RX_DATA;
+}
+
+// Data address is the first four bind packet bytes and the pipe 0 byte
+static void yd717_rx_bind(const uint8 packet[])
+{
+    uint8 addr[5];
+
+    memcpy(addr, packet, 4);
+    addr[4] = 0xC1;
+    NRF24L01_WriteRegisterMulti(NRF24L01_0A_RX_ADDR_P0, addr, 5);
+}
+
+const proto_rx_desc yd717_rx_desc = {
+    .name = "YD717",
+    .init = yd717_rx_init,
+    .read = yd717_rx_read,
+    .decode = yd717_rx_decode,
+    .bind = yd717_rx_bind,
+};